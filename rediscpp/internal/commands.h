@@ -2,25 +2,28 @@
 #define REDIS_INTERNAL_IMPL_H
 #include "rediscpp/redis_endpoint.h"
 #include "rediscpp/redis_reply.h"
+#include "rediscpp/redis_pipeline.h"
+#include "rediscpp/redis_cluster.h"
+#include "rediscpp/internal/resp.h"
 #include "result/results.h"
-#include <hiredis/hiredis.h>
 #include <type_traits>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
 
 namespace redis {
     namespace internal {
-        template<typename ...Args>
-        auto run_op(redis::end_point& endpoint, const char* command, Args...args) -> ::result<result::any, std::string> {
+        // run the command that was already encoded into the end point buffer
+        inline auto run_encoded(redis::end_point& endpoint) -> ::result<result::any, std::string> {
             using namespace std::string_literals;
 
-            if (!endpoint) {
-                return failed("not connected"s);
+            const auto r = resp::execute(endpoint, buffers(endpoint).out);
+            if (r.is_error()) {
+                return r;
             }
-            const auto out = result::any::from(
-                    (const redisReply*)std::invoke(redisCommand, cast(endpoint),
-                        command,
-                        std::forward<decltype(args)>(args)...
-                ));
+            const auto out = r.unwrap();
             if (out.is_error()) {
                 const auto ev = result::try_into<result::error>(out);
                 const auto e = ev.unwrap();
@@ -31,13 +34,28 @@ namespace redis {
             return ok(out);
         }
 
+        // run a command - the first argument is the command name, and the rest are
+        // its arguments, they can be either strings or integers, for example
+        // run_op(ep, "INCRBY", "my counter", 10);
+        template<typename ...Args>
+        auto run_op(redis::end_point& endpoint, const Args&... args) -> ::result<result::any, std::string> {
+            using namespace std::string_literals;
+
+            if (!endpoint) {
+                return failed("not connected"s);
+            }
+            auto& request = buffers(endpoint).out;
+            request.clear();
+            request.command(args...);
+            return run_encoded(endpoint);
+        }
+
         template<typename Result>
         struct process {
             template<typename ...Args>
-            static auto run(redis::end_point& endpoint, const char* command, Args...args) -> ::result<Result, std::string> {
-                auto r = 
-                    run_op(endpoint, command, 
-                            std::forward<decltype(args)>(args)...).
+            static auto run(redis::end_point& endpoint, const Args&... args) -> ::result<Result, std::string> {
+                auto r =
+                    run_op(endpoint, args...).
                                     and_then([](auto&& res) -> ::result<Result, std::string> {
                                          return result::try_into<Result>(res);
                                     }
@@ -48,9 +66,8 @@ namespace redis {
         template<>
         struct process<void> {
             template<typename ...Args>
-            static auto run(redis::end_point& endpoint, const char* command, Args...args) -> ::result<bool, std::string> {
-                const auto r = //std::invoke(
-                    run_op(endpoint, command, std::forward<decltype(args)>(args)...);
+            static auto run(redis::end_point& endpoint, const Args&... args) -> ::result<bool, std::string> {
+                const auto r = run_op(endpoint, args...);
                 if (r.is_error()) {
                     return failed(r.error_value());
                 }
@@ -63,8 +80,8 @@ namespace redis {
             using result_type = T;
 
             template<typename ...Args>
-            static auto run(redis::end_point& endpoint, const char* command, Args...args) -> result_type {
-                const auto r = process<T>::run(endpoint, command, std::forward<decltype(args)>(args)...);
+            static auto run(redis::end_point& endpoint, const Args&... args) -> result_type {
+                const auto r = process<T>::run(endpoint, args...);
                 if (r.is_error()) {
                     throw connection_error(r.error_value());
                 }
@@ -75,8 +92,73 @@ namespace redis {
                 }
             }
         };
+
+        // read a string value (GET) or a field of hash (HGET) - if the end point has a near
+        // cache, we are first looking there, and store what we read from the server there
+        template<typename ...Field>
+        auto read_through(redis::end_point& endpoint, const char* command, const std::string& key, const Field&... field) -> ::result<std::string, std::string> {
+            static_assert(sizeof...(Field) <= 1, "we only support keys or fields of hashes");
+
+            auto cache = endpoint ? near_cache_of(endpoint) : nullptr;
+            if (cache && cache->cacheable(key)) {
+                // first make sure that we know about all the changes the server told us about
+                if (resp::drain(endpoint).is_error()) {
+                    cache->clear();     // we cannot trust it anymore
+                    cache = nullptr;
+                } else if (auto v = cache->find(key, field...); v) {
+                    return ok(std::move(*v));
+                }
+            } else {
+                cache = nullptr;
+            }
+            const auto r = process<result::string>::run(endpoint, command, key, field...);
+            if (r.is_error()) {
+                return failed(r.error_value());
+            }
+            auto value = result::to_string(r.unwrap());
+            if (cache) {
+                cache->store(key, field..., value);
+            }
+            return ok(std::move(value));
+        }
+
+        // same as process above, only that the command is queued to the pipeline, and the
+        // result would only be available after the pipeline was executed
+        template<typename T, typename ...Args>
+        auto queue(redis::pipeline& batch, const Args&... args) -> redis::deferred<T> {
+            batch.encoder().command(args...);
+            return redis::deferred<T>{batch.track()};
+        }
+
+        // split the indices of the keys into groups of at most chunk keys. When the commands are
+        // routed (cluster) all the keys in a group must be in the same slot
+        template<typename Key>
+        auto group(redis::end_point& ep, std::size_t count, std::size_t chunk, Key&& key) -> std::vector<std::vector<std::size_t>> {
+            chunk = std::max<std::size_t>(chunk, 1);
+            std::vector<std::vector<std::size_t>> groups;
+            if (!buffers(ep).route) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (i % chunk == 0) {
+                        groups.emplace_back();
+                    }
+                    groups.back().push_back(i);
+                }
+                return groups;
+            }
+            std::unordered_map<std::uint16_t, std::size_t> filling;     // the group that we are filling for each slot
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto slot = redis::cluster_end_point::slot(key(i));
+                auto at = filling.find(slot);
+                if (at == filling.end() || groups[at->second].size() >= chunk) {
+                    groups.emplace_back();
+                    at = filling.insert_or_assign(slot, groups.size() - 1).first;
+                }
+                groups[at->second].push_back(i);
+            }
+            return groups;
+        }
     }   // end of namespace internal
 }       // end of namespace redis
 #else
 #   error "you cannot include this inside header file!!"
-#endif // REDIS_INTERNAL_IMPL_H
\ No newline at end of file
+#endif // REDIS_INTERNAL_IMPL_H
@@ -0,0 +1,60 @@
+#ifndef REDIS_INTERNAL_PUBSUB_H
+#define REDIS_INTERNAL_PUBSUB_H
+#include "rediscpp/redis_reply.h"
+#include <string_view>
+
+// the commands and the messages for classic and sharded (redis 7) pub/sub are the same,
+// only that the sharded ones are prefixed with S, and are only going to the node that owns
+// the slot of the channel
+
+namespace redis {
+    namespace internal {
+        namespace pubsub {
+            inline auto publish_command(bool sharded) -> const char* {
+                return sharded ? "SPUBLISH" : "PUBLISH";
+            }
+
+            inline auto subscribe_command(bool sharded) -> const char* {
+                return sharded ? "SSUBSCRIBE" : "SUBSCRIBE";
+            }
+
+            inline auto unsubscribe_command(bool sharded) -> const char* {
+                return sharded ? "SUNSUBSCRIBE" : "UNSUBSCRIBE";
+            }
+
+            struct event {
+                enum kind_t {
+                    MESSAGE,        // [(s)message, channel, payload]
+                    UNSUBSCRIBED,   // [(s)unsubscribe, channel, count] - with sharded channels, the server sends this when the slot moved
+                    OTHER           // confirmation for subscribe, pong ..
+                };
+
+                kind_t kind = OTHER;
+                std::string_view channel;
+                std::string_view payload;
+            };
+
+            // the views are only valid as long as the reply is alive
+            inline auto classify(const result::any& reply, bool sharded) -> event {
+                const auto message = reply.as_array();
+                if (message.is_error() || message.unwrap().size() < 3) {
+                    return {};
+                }
+                const auto& m = message.unwrap();
+                const auto text = [&m](std::size_t at) {
+                    const auto s = result::try_into<result::string>(m.view(at));
+                    return s.is_ok() ? s.unwrap().message() : std::string_view{};
+                };
+                const auto kind = text(0);
+                if (kind == (sharded ? "smessage" : "message")) {
+                    return event{event::MESSAGE, text(1), text(2)};
+                }
+                if (kind == (sharded ? "sunsubscribe" : "unsubscribe")) {
+                    return event{event::UNSUBSCRIBED, text(1), {}};
+                }
+                return {};
+            }
+        }   // end of namespace pubsub
+    }   // end of namespace internal
+}       // end of namespace redis
+#endif  // REDIS_INTERNAL_PUBSUB_H
@@ -0,0 +1,690 @@
+#include "rediscpp/internal/resp.h"
+#include "rediscpp/internal/router.h"
+#include <hiredis/hiredis.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <cctype>
+#include <new>
+#include <cerrno>
+
+#ifdef WIN32
+#   include <Winsock2.h>
+#else   // not WIN32
+#   include <sys/types.h>
+#   include <sys/socket.h>
+#   include <poll.h>
+#endif  // not WIN32
+
+namespace redis {
+namespace internal {
+namespace resp {
+
+using namespace std::string_literals;
+
+namespace
+{
+    constexpr std::size_t READ_CHUNK = 16 * 1024;
+    constexpr int MAX_DEPTH = 64;       // we are not expecting replies that are nested deeper than this
+    constexpr std::size_t MAX_REUSED_BLOCK = 1024 * 1024;  // don't hold on to the memory of very large replies
+
+#if defined(MSG_NOSIGNAL)
+    constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    constexpr int SEND_FLAGS = 0;
+#endif
+
+    auto line_end(const char* from, const char* end) -> const char* {
+        while (from < end) {
+            const auto cr = static_cast<const char*>(std::memchr(from, '\r', static_cast<std::size_t>(end - from)));
+            if (!cr || cr + 1 >= end) {
+                return nullptr;
+            }
+            if (cr[1] == '\n') {
+                return cr;
+            }
+            from = cr + 1;
+        }
+        return nullptr;
+    }
+
+    auto to_integer(const char* from, const char* to, long long& out) -> bool {
+        const auto [ptr, ec] = std::from_chars(from, to, out);
+        return ec == std::errc{} && ptr == to;
+    }
+
+    auto aggregate_size(char type, long long count) -> std::size_t {
+        // map is a list of key value pairs, we are flatting it into an array
+        return static_cast<std::size_t>(type == '%' ? count * 2 : count);
+    }
+
+    auto is_aggregate(char type) -> bool {
+        return type == '*' || type == '%' || type == '~' || type == '>';
+    }
+
+    auto is_bulk(char type) -> bool {
+        return type == '$' || type == '!' || type == '=';
+    }
+
+    // first pass - make sure that we have the complete reply and find out how much memory we need for it.
+    // When we don't have all of it yet, the state keeps the element that we stopped at, so we would only
+    // scan from there when more data arrives
+    struct scanner {
+        const char* end;
+        scan_state& state;
+        std::size_t need = 0;
+        std::string error;
+
+        // return the end of the reply that starts at the given position, once we have all of it
+        auto scan(const char* start) -> const char* {
+            auto at = start + state.offset;
+            while (true) {
+                bool complete = false;
+                const auto next = element(at, complete);
+                if (!next) {
+                    state.offset = static_cast<std::size_t>(at - start);
+                    return nullptr;
+                }
+                at = next;
+                if (complete && close()) {
+                    return at;
+                }
+            }
+        }
+
+        // scan a single element - for aggregates this is only their header, and their
+        // elements are scanned next. Return where the next element starts
+        auto element(const char* at, bool& complete) -> const char* {
+            if (at >= end) {
+                need = 1;
+                return nullptr;
+            }
+            const auto type = *at;
+            const auto le = line_end(at + 1, end);
+            if (!le) {
+                need = 1;
+                return nullptr;
+            }
+            const auto next = le + 2;
+            auto& total = state.total;
+            long long value = 0;
+            complete = true;
+            switch (type) {
+                case '+': case '-': case ',': case '(':
+                    ++total.nodes;
+                    total.bytes += static_cast<std::size_t>(le - at - 1) + 1;
+                    return next;
+                case '_': case '#':
+                    ++total.nodes;
+                    return next;
+                case ':':
+                    if (!to_integer(at + 1, le, value)) {
+                        error = "protocol error: invalid integer reply"s;
+                        return nullptr;
+                    }
+                    ++total.nodes;
+                    return next;
+                default:
+                    break;
+            }
+            if (!to_integer(at + 1, le, value)) {
+                error = "protocol error: invalid length in reply"s;
+                return nullptr;
+            }
+            if (is_bulk(type)) {
+                if (value < 0) {
+                    ++total.nodes;
+                    return next;    // null reply
+                }
+                const auto size = static_cast<std::size_t>(value);
+                if (static_cast<std::size_t>(end - next) < size + 2) {
+                    need = size + 2 - static_cast<std::size_t>(end - next);
+                    return nullptr;
+                }
+                ++total.nodes;
+                total.bytes += size + 1;
+                return next + size + 2;
+            }
+            if (!is_aggregate(type) && type != '|') {
+                error = "protocol error: unknown reply type '"s + type + "'";
+                return nullptr;
+            }
+            const auto attribute = type == '|';
+            const auto count = value < 0 ? 0 : aggregate_size(attribute ? '%' : type, value);
+            if (!attribute) {
+                ++total.nodes;
+                total.pointers += count;
+            }
+            complete = !attribute && count == 0;
+            if (count == 0) {
+                return next;
+            }
+            if (state.open.size() >= MAX_DEPTH) {
+                error = "protocol error: reply is nested too deep"s;
+                return nullptr;
+            }
+            // attributes are not something that we are using, so the memory for them is not counted
+            state.open.push_back(scan_state::frame{count, attribute, total});
+            complete = false;
+            return next;
+        }
+
+        // an element was completed, close the aggregates that it was the last element of.
+        // Return true once the whole reply is complete
+        auto close() -> bool {
+            auto& open = state.open;
+            while (!open.empty()) {
+                if (--open.back().left > 0) {
+                    return false;
+                }
+                const auto done = open.back();
+                open.pop_back();
+                if (done.attribute) {
+                    state.total = done.saved;
+                    return false;   // the element that the attribute is for is next
+                }
+            }
+            return true;
+        }
+    };
+
+    // second pass - place the reply into the memory block. At this point we know that the reply is valid
+    struct builder {
+        const char* end;
+        redisReply* nodes;
+        redisReply** pointers;
+        char* bytes;
+
+        auto copy(redisReply* to, const char* from, std::size_t size) -> void {
+            std::memcpy(bytes, from, size);
+            bytes[size] = '\0';
+            to->str = bytes;
+            to->len = size;
+            bytes += size + 1;
+        }
+
+        auto build(const char*& at) -> redisReply* {
+            const auto type = *at;
+            const auto le = line_end(at + 1, end);
+            const auto next = le + 2;
+            if (type == '|') {
+                long long count = 0;
+                to_integer(at + 1, le, count);
+                auto p = next;
+                for (std::size_t i = 0; count > 0 && i < aggregate_size('%', count); ++i) {
+                    scan_state skipped;
+                    p = scanner{end, skipped, 0, {}}.scan(p);
+                }
+                at = p;
+                return build(at);
+            }
+            auto node = new (nodes++) redisReply{};
+            long long value = 0;
+            switch (type) {
+                case '+':
+                    node->type = REDIS_REPLY_STATUS;
+                    copy(node, at + 1, static_cast<std::size_t>(le - at - 1));
+                    at = next;
+                    return node;
+                case '-':
+                    node->type = REDIS_REPLY_ERROR;
+                    copy(node, at + 1, static_cast<std::size_t>(le - at - 1));
+                    at = next;
+                    return node;
+                case ',': case '(':     // double and big numbers are passed as strings
+                    node->type = REDIS_REPLY_STRING;
+                    copy(node, at + 1, static_cast<std::size_t>(le - at - 1));
+                    at = next;
+                    return node;
+                case '_':
+                    node->type = REDIS_REPLY_NIL;
+                    at = next;
+                    return node;
+                case '#':
+                    node->type = REDIS_REPLY_INTEGER;
+                    node->integer = at[1] == 't' ? 1 : 0;
+                    at = next;
+                    return node;
+                case ':':
+                    node->type = REDIS_REPLY_INTEGER;
+                    to_integer(at + 1, le, value);
+                    node->integer = value;
+                    at = next;
+                    return node;
+                default:
+                    break;
+            }
+            to_integer(at + 1, le, value);
+            if (value < 0) {
+                node->type = REDIS_REPLY_NIL;
+                at = next;
+                return node;
+            }
+            if (is_bulk(type)) {
+                node->type = type == '!' ? REDIS_REPLY_ERROR : REDIS_REPLY_STRING;
+                auto from = next;
+                auto size = static_cast<std::size_t>(value);
+                if (type == '=' && size >= 4 && from[3] == ':') {  // verbatim string, skip the format
+                    from += 4;
+                    size -= 4;
+                }
+                copy(node, from, size);
+                at = next + value + 2;
+                return node;
+            }
+            // this is an aggregate type
+            const auto count = aggregate_size(type, value);
+            node->type = REDIS_REPLY_ARRAY;
+            node->elements = count;
+            node->element = pointers;
+            pointers += count;
+            at = next;
+            for (std::size_t i = 0; i < count; ++i) {
+                node->element[i] = build(at);
+            }
+            return node;
+        }
+    };
+
+    auto io_error(redisContext* c, int code, const std::string& msg) -> ::result<bool, std::string>
+    {
+        c->err = code;
+        const auto size = std::min(msg.size(), sizeof(c->errstr) - 1);
+        std::memcpy(c->errstr, msg.data(), size);
+        c->errstr[size] = '\0';
+        return failed(msg);
+    }
+
+    auto system_error(int e) -> std::string
+    {
+        if (e == EAGAIN) {  // EWOULDBLOCK is the same on linux
+            return "timeout while waiting for the server"s;
+        }
+        return std::strerror(e);
+    }
+
+    // command names are not case sensitive
+    auto same(std::string_view a, std::string_view b) -> bool
+    {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return std::toupper(static_cast<unsigned char>(x)) == std::toupper(static_cast<unsigned char>(y));
+        });
+    }
+
+    // for most commands the key is the first argument, but not for all of them
+    enum class key_at {
+        FIRST,          // GET key ..
+        SECOND,         // commands with sub commands: XGROUP CREATE key ..
+        AFTER_STREAMS   // XREAD(GROUP) .. STREAMS key ..
+    };
+
+    auto key_position(std::string_view command) -> key_at
+    {
+        if (same(command, "XREADGROUP") || same(command, "XREAD")) {
+            return key_at::AFTER_STREAMS;
+        }
+        if (same(command, "XGROUP") || same(command, "XINFO") || same(command, "OBJECT")) {
+            return key_at::SECOND;
+        }
+        return key_at::FIRST;
+    }
+
+    // we can only talk directly over the socket if there is nothing that hiredis is keeping
+    // for this connection - otherwise the order of the commands and replies would be wrong
+    auto native(const redisContext* c) -> bool
+    {
+        return sdslen(c->obuf) == 0 && (!c->reader || c->reader->pos >= c->reader->len);
+    }
+}   // end of local namespace
+
+auto reader::next() -> result_type
+{
+    return parse(false);
+}
+
+auto reader::pushes() -> ::result<bool, std::string>
+{
+    if (const auto r = parse(true); r.is_error()) {
+        return failed(r.error_value());
+    }
+    return ok(true);
+}
+
+auto reader::on_push(push_handler handler) -> void
+{
+    push_to = std::move(handler);
+}
+
+auto reader::parse(bool pushes_only) -> result_type
+{
+    while (true) {
+        if (begin == end) {
+            need = 0;
+            return ok(std::optional<result::any>{});
+        }
+        const auto data = input.data();
+        // push messages are out of band, they are not the reply to any command that we sent
+        const auto push = data[begin] == '>';
+        if (pushes_only && !push) {
+            return ok(std::optional<result::any>{});
+        }
+        scanner s{data + end, partial, 0, {}};
+        const auto stop = s.scan(data + begin);
+        if (!stop) {
+            if (!s.error.empty()) {
+                begin = end = 0;    // there is no way to recover from this
+                partial.reset();
+                return failed(s.error);
+            }
+            need = s.need;
+            return ok(std::optional<result::any>{});
+        }
+        const auto total = partial.total;
+        partial.reset();
+        // the whole reply is placed in one memory block: first the reply nodes, then
+        // the arrays of pointers to the child nodes and then the strings
+        const auto nodes_size = total.nodes * sizeof(redisReply);
+        const auto pointers_size = total.pointers * sizeof(redisReply*);
+        auto owner = allocate(nodes_size + pointers_size + total.bytes);
+        auto memory = reinterpret_cast<char*>(owner.get());
+        builder b{data + end, reinterpret_cast<redisReply*>(memory),
+            reinterpret_cast<redisReply**>(memory + nodes_size),
+            memory + nodes_size + pointers_size
+        };
+        const char* at = data + begin;
+        const auto root = b.build(at);
+        begin = static_cast<std::size_t>(stop - data);
+        if (begin == end) {
+            begin = end = 0;
+        }
+        need = 0;
+        auto reply = result::any::from(
+            result::details::lowlevel_access::handle_type(std::move(owner), root)
+        );
+        if (!push) {
+            return ok(std::optional<result::any>{std::move(reply)});
+        }
+        if (const auto message = reply.as_array(); push_to && message.is_ok()) {
+            push_to(message.unwrap());
+        }
+    }
+}
+
+auto reader::allocate(std::size_t size) -> block_type
+{
+    // we are the only one that is holding the last block, so no one is looking at it anymore
+    if (block && block_size >= size && block.use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);    // the last user may have released it from another thread
+        return block;
+    }
+    const auto count = std::max<std::size_t>((size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t), 1);
+    auto fresh = std::make_shared_for_overwrite<std::max_align_t[]>(count);
+    if (size <= MAX_REUSED_BLOCK) {
+        block = fresh;
+        block_size = count * sizeof(std::max_align_t);
+    }
+    return fresh;
+}
+
+auto reader::prepare(std::size_t size) -> char*
+{
+    if (input.size() - end < size) {
+        if (begin > 0) {    // first try to reuse the space of the replies that we already consumed
+            std::memmove(input.data(), input.data() + begin, end - begin);
+            end -= begin;
+            begin = 0;
+        }
+        if (input.size() - end < size) {
+            input.resize(std::max(end + size, input.size() * 2));
+        }
+    }
+    return input.data() + end;
+}
+
+auto reader::commit(std::size_t size) -> void
+{
+    end += size;
+}
+
+auto send(end_point& ep, std::string_view data) -> ::result<bool, std::string>
+{
+    if (!ep) {
+        return failed("not connected"s);
+    }
+    const auto c = cast(ep);
+    if (c->err) {
+        return failed("connection is in error state: "s + c->errstr);
+    }
+    if (!native(c)) {
+        // let hiredis deal with it - it would first take care of what it already has
+        if (redisAppendFormattedCommand(c, data.data(), data.size()) != REDIS_OK) {
+            return failed("failed to send command: "s + c->errstr);
+        }
+        return ok(true);
+    }
+    auto at = data.data();
+    auto left = data.size();
+    while (left > 0) {
+        const auto n = ::send(c->fd, at, left, SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return io_error(c, REDIS_ERR_IO, "failed to send to the server: " + system_error(errno));
+        }
+        at += n;
+        left -= static_cast<std::size_t>(n);
+    }
+    return ok(true);
+}
+
+auto receive(end_point& ep) -> ::result<result::any, std::string>
+{
+    if (!ep) {
+        return failed("not connected"s);
+    }
+    const auto c = cast(ep);
+    auto& in = buffers(ep).in;
+    if (in.pending() == 0 && !native(c)) {
+        // hiredis has some of the data for this connection, so it must read the next reply
+        redisReply* r = nullptr;
+        if (redisGetReply(c, (void**)&r) != REDIS_OK || !r) {
+            return failed("failed to read reply: "s + c->errstr);
+        }
+        return ok(result::any::from(r));
+    }
+    while (true) {
+        const auto r = in.next();
+        if (r.is_error()) {
+            io_error(c, REDIS_ERR_PROTOCOL, r.error_value());
+            return failed(r.error_value());
+        }
+        if (const auto reply = r.unwrap(); reply) {
+            return ok(*reply);
+        }
+        const auto size = std::max(READ_CHUNK, in.missing());
+        const auto n = ::recv(c->fd, in.prepare(size), size, 0);
+        if (n == 0) {
+            io_error(c, REDIS_ERR_EOF, "server closed the connection"s);
+            return failed("server closed the connection"s);
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            const auto msg = "failed to read from the server: " + system_error(errno);
+            io_error(c, REDIS_ERR_IO, msg);
+            return failed(msg);
+        }
+        in.commit(static_cast<std::size_t>(n));
+    }
+}
+
+auto next_request(std::string_view& data) -> std::optional<request_view>
+{
+    // this is only reading what the writer encoded, so we don't need to validate much
+    const auto read_line = [](std::string_view& from, char type) -> std::optional<std::size_t> {
+        const auto le = from.find("\r\n");
+        if (from.empty() || from[0] != type || le == std::string_view::npos) {
+            return {};
+        }
+        std::size_t value = 0;
+        const auto [ptr, ec] = std::from_chars(from.data() + 1, from.data() + le, value);
+        if (ec != std::errc{}) {
+            return {};
+        }
+        from.remove_prefix(le + 2);
+        return value;
+    };
+    const auto read_bulk = [&read_line](std::string_view& from) -> std::optional<std::string_view> {
+        const auto size = read_line(from, '$');
+        if (!size || from.size() < *size + 2) {
+            return {};
+        }
+        const auto value = from.substr(0, *size);
+        from.remove_prefix(*size + 2);
+        return value;
+    };
+
+    auto at = data;
+    const auto argc = read_line(at, '*');
+    if (!argc) {
+        return {};
+    }
+    request_view request;
+    auto position = key_at::FIRST;
+    std::string_view previous;
+    for (std::size_t i = 0; i < *argc; ++i) {
+        const auto arg = read_bulk(at);
+        if (!arg) {
+            return {};
+        }
+        if (i == 0) {
+            request.name = *arg;
+            position = key_position(*arg);
+        } else if (request.key.empty()) {
+            if ((position == key_at::FIRST && i == 1) || (position == key_at::SECOND && i == 2) ||
+                    (position == key_at::AFTER_STREAMS && same(previous, "STREAMS"))) {
+                request.key = *arg;
+            }
+        }
+        previous = *arg;
+    }
+    request.raw = data.substr(0, data.size() - at.size());
+    data = at;
+    return request;
+}
+
+auto drain(end_point& ep) -> ::result<bool, std::string>
+{
+    if (!ep) {
+        return failed("not connected"s);
+    }
+    const auto c = cast(ep);
+    if (c->err) {
+        return failed("connection is in error state: "s + c->errstr);
+    }
+    if (!native(c)) {
+        return ok(false);
+    }
+    auto& in = buffers(ep).in;
+    while (true) {
+        const auto n = ::recv(c->fd, in.prepare(READ_CHUNK), READ_CHUNK, MSG_DONTWAIT);
+        if (n == 0) {
+            io_error(c, REDIS_ERR_EOF, "server closed the connection"s);
+            return failed("server closed the connection"s);
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {  // nothing more to read
+                break;
+            }
+            const auto msg = "failed to read from the server: " + system_error(errno);
+            io_error(c, REDIS_ERR_IO, msg);
+            return failed(msg);
+        }
+        in.commit(static_cast<std::size_t>(n));
+        if (static_cast<std::size_t>(n) < READ_CHUNK) {
+            break;
+        }
+    }
+    if (const auto r = in.pushes(); r.is_error()) {
+        io_error(c, REDIS_ERR_PROTOCOL, r.error_value());
+        return r;
+    }
+    return ok(true);
+}
+
+auto fill(end_point& ep, std::chrono::milliseconds timeout, int interrupt) -> ::result<bool, std::string>
+{
+    if (!ep) {
+        return failed("not connected"s);
+    }
+    const auto c = cast(ep);
+    if (c->err) {
+        return failed("connection is in error state: "s + c->errstr);
+    }
+    pollfd wait_for[2] = {{c->fd, POLLIN, 0}, {interrupt, POLLIN, 0}};
+    const nfds_t count = interrupt < 0 ? 1 : 2;
+    int ready = 0;
+    do {
+        ready = ::poll(wait_for, count, timeout.count() < 0 ? -1 : static_cast<int>(timeout.count()));
+    } while (ready < 0 && errno == EINTR);
+    if (ready < 0) {
+        return failed("failed to wait for the server: " + system_error(errno));
+    }
+    if (ready == 0 || (wait_for[0].revents == 0)) {
+        return ok(false);   // timeout or we were interrupted
+    }
+    // read everything that is available now, so that under load we are doing few large reads
+    auto& in = buffers(ep).in;
+    bool got = false;
+    while (true) {
+        const auto size = std::max(READ_CHUNK, in.missing());
+        const auto n = ::recv(c->fd, in.prepare(size), size, MSG_DONTWAIT);
+        if (n == 0) {
+            io_error(c, REDIS_ERR_EOF, "server closed the connection"s);
+            return failed("server closed the connection"s);
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                return ok(got);
+            }
+            const auto msg = "failed to read from the server: " + system_error(errno);
+            io_error(c, REDIS_ERR_IO, msg);
+            return failed(msg);
+        }
+        in.commit(static_cast<std::size_t>(n));
+        got = true;
+        if (static_cast<std::size_t>(n) < size) {
+            return ok(true);
+        }
+    }
+}
+
+auto execute(end_point& ep, const writer& request) -> ::result<result::any, std::string>
+{
+    if (ep) {
+        if (const auto& route = buffers(ep).route; route) {
+            auto replies = route->execute(request.data(), 1);
+            if (replies.empty()) {
+                return failed("no reply for the command"s);
+            }
+            return std::move(replies.front());
+        }
+    }
+    if (const auto e = Error(send(ep, request.data())); e) {
+        return failed(e.value());
+    }
+    return receive(ep);
+}
+
+}   // end of namespace resp
+}   // end of namespace internal
+}   // end of namespace redis
+
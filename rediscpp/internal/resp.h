@@ -0,0 +1,224 @@
+#ifndef REDIS_INTERNAL_RESP_H
+#define REDIS_INTERNAL_RESP_H
+#include "rediscpp/redis_endpoint.h"
+#include "rediscpp/redis_reply.h"
+#include "rediscpp/redis_near_cache.h"
+#include "result/results.h"
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// This is the native implementation of redis protocol (RESP2 and RESP3)
+// the writer is encoding the commands directly into a buffer that is reused
+// between commands, so there is no need to format the command from printf like format string.
+// The reader is parsing replies into a single memory block, so that we would not have allocation
+// per reply element, and the strings that we are returning are pointing into this block.
+// The elements of the reply are only pointers into the block. If the reply was released by the
+// time the next reply arrives, its block is reused, so normally there is no allocation at all.
+// see https://redis.io/docs/reference/protocol-spec/
+
+namespace redis {
+    namespace internal {
+        struct router;
+
+        namespace resp {
+            // encode commands into RESP array of bulk strings
+            struct writer {
+                // start new command with the given number of arguments (including the command name)
+                auto begin(std::size_t argc) -> writer& {
+                    return header('*', argc);
+                }
+
+                auto arg(std::string_view a) -> writer& {
+                    header('$', a.size());
+                    buffer.append(a.data(), a.size());
+                    buffer.append("\r\n", 2);
+                    return *this;
+                }
+
+                auto arg(const std::string& a) -> writer& {
+                    return arg(std::string_view{a});
+                }
+
+                auto arg(const char* a) -> writer& {
+                    return arg(std::string_view{a});
+                }
+
+                template<typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+                auto arg(T value) -> writer& {
+                    char tmp[24];
+                    const auto [end, ec] = std::to_chars(tmp, tmp + sizeof(tmp), value);
+                    return arg(std::string_view(tmp, static_cast<std::size_t>(end - tmp)));
+                }
+
+                // encode a full command - the first argument is the command name
+                template<typename ...Args>
+                auto command(const Args&... args) -> writer& {
+                    begin(sizeof...(Args));
+                    (arg(args), ...);
+                    return *this;
+                }
+
+                auto data() const -> std::string_view {
+                    return buffer;
+                }
+
+                auto size() const -> std::size_t {
+                    return buffer.size();
+                }
+
+                auto empty() const -> bool {
+                    return buffer.empty();
+                }
+
+                // we are keeping the memory so that the next command would not allocate
+                auto clear() -> void {
+                    buffer.clear();
+                }
+
+            private:
+                auto header(char type, std::size_t count) -> writer& {
+                    char tmp[24];
+                    tmp[0] = type;
+                    const auto [end, ec] = std::to_chars(tmp + 1, tmp + sizeof(tmp) - 2, count);
+                    auto e = end;
+                    *e++ = '\r';
+                    *e++ = '\n';
+                    buffer.append(tmp, static_cast<std::size_t>(e - tmp));
+                    return *this;
+                }
+
+                std::string buffer;
+            };
+
+            // how far we got with a reply that we only have part of, so that once more data
+            // arrives we continue from there, and don't scan the reply again from its start
+            struct scan_state {
+                // the amount of memory that we need to allocate for the reply
+                struct counts {
+                    std::size_t nodes = 0;
+                    std::size_t pointers = 0;
+                    std::size_t bytes = 0;
+                };
+
+                // an aggregate that we still need elements for
+                struct frame {
+                    std::size_t left = 0;
+                    bool attribute = false;     // attributes are not part of the reply
+                    counts saved;               // the counts from before the attribute
+                };
+
+                auto reset() -> void {
+                    offset = 0;
+                    total = counts{};
+                    open.clear();
+                }
+
+                std::size_t offset = 0;     // from the start of the reply, the element that we stopped at
+                counts total;
+                std::vector<frame> open;
+            };
+
+            // parse replies from the data that was read from the server - each
+            // reply is placed in a single memory block
+            struct reader {
+                using result_type = ::result<std::optional<result::any>, std::string>;
+                using push_handler = std::function<void(const result::array&)>;
+
+                // extract the next reply, if we don't have all of it yet, return empty reply.
+                // push messages (RESP3) are not returned from here, they are passed to the push handler
+                auto next() -> result_type;
+
+                // only process the push messages that we have, and stop at the first reply
+                auto pushes() -> ::result<bool, std::string>;
+
+                // without handler, push messages are dropped
+                auto on_push(push_handler handler) -> void;
+
+                // return memory to read new data into, at least of the given size
+                auto prepare(std::size_t size) -> char*;
+
+                // mark that we have read this number of bytes into the memory returned from prepare
+                auto commit(std::size_t size) -> void;
+
+                // the number of bytes that we have and were not parsed yet
+                auto pending() const -> std::size_t {
+                    return end - begin;
+                }
+
+                // how many bytes we are missing to complete the current reply - this is
+                // only an hint, as we may find out that we need more
+                auto missing() const -> std::size_t {
+                    return need;
+                }
+
+            private:
+                using block_type = std::shared_ptr<std::max_align_t[]>;
+
+                // return memory for a reply of the given size - if the user is done with
+                // the last reply we are reusing its memory
+                auto allocate(std::size_t size) -> block_type;
+
+                auto parse(bool pushes_only) -> result_type;
+
+                std::vector<char> input;
+                std::size_t begin = 0;
+                std::size_t end = 0;
+                std::size_t need = 0;
+                scan_state partial;         // of the reply at begin
+                block_type block;
+                std::size_t block_size = 0;
+                push_handler push_to;
+            };
+
+            // the state that we have per connection
+            struct connection {
+                writer out;
+                reader in;
+                std::unique_ptr<near_cache> cache;
+                std::shared_ptr<router> route;      // when set, the commands are not sent over this connection
+            };
+
+            // a single command inside a buffer of encoded commands
+            struct request_view {
+                std::string_view raw;       // the whole encoded command
+                std::string_view name;
+                std::string_view key;       // the key that the command is using (mostly the first argument), can be empty
+            };
+
+            // extract the next command that was encoded by the writer and remove it from the data
+            auto next_request(std::string_view& data) -> std::optional<request_view>;
+
+            // send the data to the server - we would block until all the data was sent.
+            // Note that if hiredis has some pending data for this connection, we are
+            // letting it send the data, so that the order of the commands is kept
+            auto send(end_point& ep, std::string_view data) -> ::result<bool, std::string>;
+
+            // read one reply from the server, again if hiredis is holding part of the reply
+            // we would let it read the reply
+            auto receive(end_point& ep) -> ::result<result::any, std::string>;
+
+            // read whatever the server already sent us without waiting, and process the
+            // push messages that are in it
+            auto drain(end_point& ep) -> ::result<bool, std::string>;
+
+            // wait up to the timeout for data from the server (negative timeout is waiting forever),
+            // and read whatever is available into the connection reader. Return false on timeout.
+            // If interrupt is a valid descriptor, we are also returning false once it is readable
+            auto fill(end_point& ep, std::chrono::milliseconds timeout, int interrupt = -1) -> ::result<bool, std::string>;
+
+            // send the request that is encoded in the writer and wait for the reply
+            auto execute(end_point& ep, const writer& request) -> ::result<result::any, std::string>;
+        }   // end of namespace resp
+    }   // end of namespace internal
+}       // end of namespace redis
+#endif  // REDIS_INTERNAL_RESP_H
+
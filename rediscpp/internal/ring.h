@@ -0,0 +1,106 @@
+#ifndef REDIS_INTERNAL_RING_H
+#define REDIS_INTERNAL_RING_H
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+// Bounded lock free queue (based on Dmitry Vyukov bounded MPMC queue). Each slot has
+// a sequence number that tells whether it is ready to be written or read, so producers and
+// consumers never touch the same slot at the same time. The values in the slots are never
+// destroyed, so a value that own memory (std::string) is reusing its memory on the next push
+
+namespace redis {
+    namespace internal {
+        template<typename T>
+        struct ring {
+            // the capacity is rounded up to the next power of 2
+            explicit ring(std::size_t capacity) : mask{round_up(capacity) - 1},
+                slots{std::make_unique<slot[]>(mask + 1)} {
+                for (std::size_t i = 0; i <= mask; ++i) {
+                    slots[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            ring(const ring&) = delete;
+            ring& operator = (const ring&) = delete;
+
+            // fill is called with the slot value to write into, return false if the queue is full
+            template<typename Fill>
+            auto try_push(Fill&& fill) -> bool {
+                auto at = tail.load(std::memory_order_relaxed);
+                while (true) {
+                    auto& s = slots[at & mask];
+                    const auto seq = s.sequence.load(std::memory_order_acquire);
+                    const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(at);
+                    if (diff == 0) {
+                        if (tail.compare_exchange_weak(at, at + 1, std::memory_order_relaxed)) {
+                            fill(s.value);
+                            s.sequence.store(at + 1, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (diff < 0) {
+                        return false;
+                    } else {
+                        at = tail.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // take is called with the slot value to read from, return false if the queue is empty
+            template<typename Take>
+            auto try_pop(Take&& take) -> bool {
+                auto at = head.load(std::memory_order_relaxed);
+                while (true) {
+                    auto& s = slots[at & mask];
+                    const auto seq = s.sequence.load(std::memory_order_acquire);
+                    const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(at + 1);
+                    if (diff == 0) {
+                        if (head.compare_exchange_weak(at, at + 1, std::memory_order_relaxed)) {
+                            take(s.value);
+                            s.sequence.store(at + mask + 1, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (diff < 0) {
+                        return false;
+                    } else {
+                        at = head.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // this is only an estimation when there are pushes or pops at the same time
+            auto size() const -> std::size_t {
+                const auto t = tail.load(std::memory_order_relaxed);
+                const auto h = head.load(std::memory_order_relaxed);
+                return t > h ? t - h : 0;
+            }
+
+            auto capacity() const -> std::size_t {
+                return mask + 1;
+            }
+
+        private:
+            static constexpr std::size_t CACHE_LINE = 64;
+
+            struct slot {
+                std::atomic<std::size_t> sequence{0};
+                T value{};
+            };
+
+            static auto round_up(std::size_t n) -> std::size_t {
+                std::size_t p = 2;
+                while (p < n) {
+                    p <<= 1;
+                }
+                return p;
+            }
+
+            const std::size_t mask;
+            std::unique_ptr<slot[]> slots;
+            alignas(CACHE_LINE) std::atomic<std::size_t> tail{0};      // the next place to push into
+            alignas(CACHE_LINE) std::atomic<std::size_t> head{0};      // the next place to pop from
+        };
+    }   // end of namespace internal
+}       // end of namespace redis
+#endif  // REDIS_INTERNAL_RING_H
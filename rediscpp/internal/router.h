@@ -0,0 +1,31 @@
+#ifndef REDIS_INTERNAL_ROUTER_H
+#define REDIS_INTERNAL_ROUTER_H
+#include "rediscpp/redis_reply.h"
+#include "result/results.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+// An end point normally sends the commands over its own connection. When the end point is
+// the front of more than one server (for example redis cluster), it has a router that is
+// choosing the server for each command. This way all the proxies (rmap, rstring ..) and the
+// pipeline are working the same regardless of how many servers we have behind the end point
+
+namespace redis {
+    namespace internal {
+        struct router {
+            using reply_type = ::result<result::any, std::string>;
+            using replies_type = std::vector<reply_type>;
+
+            virtual ~router() = default;
+
+            // execute the given number of commands that were encoded with resp::writer. The replies are
+            // returned in the same order as the commands. Error replies from the server are returned as
+            // replies and not as failures, failure means that we could not get the reply at all
+            virtual auto execute(std::string_view requests, std::size_t count) -> replies_type = 0;
+        };
+    }   // end of namespace internal
+}       // end of namespace redis
+#endif  // REDIS_INTERNAL_ROUTER_H
+
@@ -0,0 +1,66 @@
+#include "rediscpp/internal/wakeup.h"
+#include <stdexcept>
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#if defined(__linux__)
+#   include <sys/eventfd.h>
+#endif  // __linux__
+
+namespace redis {
+namespace internal {
+
+wakeup::wakeup()
+{
+#if defined(__linux__)
+    read_end = write_end = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (read_end < 0) {
+        throw std::runtime_error("failed to create eventfd for wakeup");
+    }
+#else
+    int ends[2];
+    if (::pipe(ends) != 0) {
+        throw std::runtime_error("failed to create pipe for wakeup");
+    }
+    for (const auto fd : ends) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    read_end = ends[0];
+    write_end = ends[1];
+#endif  // __linux__
+}
+
+wakeup::~wakeup()
+{
+    ::close(read_end);
+    if (write_end != read_end) {
+        ::close(write_end);
+    }
+}
+
+auto wakeup::notify() -> void
+{
+    const std::uint64_t one = 1;
+    // if this fails it is because it is already full, which means that it is already notified
+    [[maybe_unused]] const auto r = ::write(write_end, &one, sizeof(one));
+}
+
+auto wakeup::consume() -> bool
+{
+    std::uint64_t buffer[8];
+    bool notified = false;
+    while (::read(read_end, buffer, sizeof(buffer)) > 0) {
+        notified = true;
+    }
+    return notified;
+}
+
+auto wakeup::handle() const -> int
+{
+    return read_end;
+}
+
+}   // end of namespace internal
+}   // end of namespace redis
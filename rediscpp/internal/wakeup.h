@@ -0,0 +1,33 @@
+#ifndef REDIS_INTERNAL_WAKEUP_H
+#define REDIS_INTERNAL_WAKEUP_H
+
+// This is used to wake up a thread that is waiting (poll) on a socket, from other thread,
+// without sending anything over the network. On linux this is an eventfd, and on other
+// systems a pipe. The waiting thread is adding the handle to the list of descriptors it polls on
+
+namespace redis {
+    namespace internal {
+        struct wakeup {
+            wakeup();
+
+            ~wakeup();
+
+            wakeup(const wakeup&) = delete;
+            wakeup& operator = (const wakeup&) = delete;
+
+            // can be called from any thread, any number of times
+            auto notify() -> void;
+
+            // return true if notify was called since the last time, and reset it
+            auto consume() -> bool;
+
+            // the descriptor to poll on - it is readable after notify
+            auto handle() const -> int;
+
+        private:
+            int read_end = -1;
+            int write_end = -1;
+        };
+    }   // end of namespace internal
+}       // end of namespace redis
+#endif  // REDIS_INTERNAL_WAKEUP_H
@@ -0,0 +1,59 @@
+#include "rediscpp/internal/worker.h"
+
+namespace redis {
+namespace internal {
+
+worker::worker(std::mutex& owner_lock) : lock{owner_lock}
+{
+}
+
+worker::~worker()
+{
+    stop();
+}
+
+auto worker::start(due_t due, task_t task) -> void
+{
+    thread = std::thread([this, due = std::move(due), task = std::move(task)]() {
+        run(due, task);
+    });
+}
+
+auto worker::wake() -> void
+{
+    condition.notify_one();
+}
+
+auto worker::stop() -> void
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        halted = true;
+    }
+    condition.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+auto worker::run(const due_t& due, const task_t& task) -> void
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (!halted) {
+        const auto at = due();
+        if (at == NEVER) {
+            condition.wait(guard);
+            continue;   // the state was changed, ask again
+        }
+        if (at > clock_type::now()) {
+            condition.wait_until(guard, at);
+            continue;
+        }
+        guard.unlock();
+        task();
+        guard.lock();
+    }
+}
+
+}   // end of namespace internal
+}   // end of namespace redis
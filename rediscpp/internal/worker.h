@@ -0,0 +1,60 @@
+#ifndef REDIS_INTERNAL_WORKER_H
+#define REDIS_INTERNAL_WORKER_H
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
+
+// This is the background thread of the types that are batching work and sending it later
+// (buffered map, aggregated counter, id sequence ..). The thread is waiting on the lock of its
+// owner, since this is the lock that protects the state that tells it whether there is work to do.
+// Each time it wakes up, it asks the owner when the work is due, and runs it (without the lock) once
+// this time passed. Stopping it is waiting for the work that is running to finish.
+
+namespace redis {
+    namespace internal {
+        struct worker {
+            using clock_type = std::chrono::steady_clock;
+            // called with the lock held - return the time when the work should run next, anything
+            // that already passed (NOW) is running it at once, and NEVER is only waiting for wake
+            using due_t = std::function<clock_type::time_point()>;
+            // called without the lock
+            using task_t = std::function<void()>;
+
+            static constexpr auto NOW = clock_type::time_point::min();
+            static constexpr auto NEVER = clock_type::time_point::max();
+
+            explicit worker(std::mutex& owner_lock);
+
+            // stop, if it wasn't stopped already
+            ~worker();
+
+            worker(const worker&) = delete;
+            worker& operator = (const worker&) = delete;
+
+            // start the thread - this is done last in the owner constructor, once the state is ready
+            auto start(due_t due, task_t task) -> void;
+
+            // call after the state that due is looking at was changed (and the lock was released)
+            auto wake() -> void;
+
+            // wait for the thread to exit - after this the owner can do the last of the work itself
+            auto stop() -> void;
+
+            // must be called with the lock held
+            auto stopped() const -> bool {
+                return halted;
+            }
+
+        private:
+            auto run(const due_t& due, const task_t& task) -> void;
+
+            std::mutex& lock;
+            std::condition_variable condition;
+            bool halted = false;
+            std::thread thread;
+        };
+    }   // end of namespace internal
+}       // end of namespace redis
+#endif  // REDIS_INTERNAL_WORKER_H
@@ -0,0 +1,135 @@
+#include "redis_aggregated_counter.h"
+#include "rediscpp/internal/commands.h"
+#include <charconv>
+#include <thread>
+#include <algorithm>
+
+namespace redis
+{
+
+namespace
+{
+    // each thread is using the same slot in all the counters
+    auto thread_index() -> std::size_t
+    {
+        static std::atomic<std::size_t> next{0};
+        thread_local const auto index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    auto slots_for(std::size_t requested) -> std::size_t
+    {
+        const auto wanted = std::max<std::size_t>(requested != 0 ? requested : std::thread::hardware_concurrency(), 1);
+        std::size_t out = 1;
+        while (out < wanted) {
+            out <<= 1;
+        }
+        return out;
+    }
+}   // end of local namespace
+
+aggregated_counter::aggregated_counter(end_point ep, std::string name) :
+    aggregated_counter(std::move(ep), std::move(name), options{})
+{
+}
+
+aggregated_counter::aggregated_counter(end_point ep, std::string name, options opts) :
+    connection{std::move(ep)}, key{std::move(name)}, config{opts}
+{
+    const auto count = slots_for(config.slots);
+    slots = std::make_unique<slot[]>(count);
+    mask = count - 1;
+    const auto current = internal::process_validate<result::any>::run(connection, "GET", key);
+    if (const auto s = current.as_string(); s.is_ok()) {
+        const auto text = s.unwrap().message();
+        value_type value = 0;
+        if (std::from_chars(text.data(), text.data() + text.size(), value).ec != std::errc{}) {
+            throw connection_error("the value of " + key + " is not a number");
+        }
+        last = value;
+    }
+    next_flush = internal::worker::clock_type::now() + config.interval;
+    flusher.start([this]() { return next_flush; }, [this]() {
+        flush();
+        next_flush = internal::worker::clock_type::now() + config.interval;
+    });
+}
+
+aggregated_counter::~aggregated_counter()
+{
+    flusher.stop();
+    flush();
+}
+
+auto aggregated_counter::add(value_type by) -> void
+{
+    slots[thread_index() & mask].delta.fetch_add(by, std::memory_order_relaxed);
+}
+
+auto aggregated_counter::operator ++ () -> aggregated_counter&
+{
+    add(1);
+    return *this;
+}
+
+auto aggregated_counter::operator -- () -> aggregated_counter&
+{
+    add(-1);
+    return *this;
+}
+
+auto aggregated_counter::operator += (value_type by) -> aggregated_counter&
+{
+    add(by);
+    return *this;
+}
+
+auto aggregated_counter::operator -= (value_type by) -> aggregated_counter&
+{
+    add(-by);
+    return *this;
+}
+
+auto aggregated_counter::read_approx() const -> value_type
+{
+    auto total = last.load(std::memory_order_acquire) + sending.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i <= mask; ++i) {
+        total += slots[i].delta.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+auto aggregated_counter::flush() -> result_t
+{
+    std::lock_guard<std::mutex> guard(lock);
+    value_type total = 0;
+    for (std::size_t i = 0; i <= mask; ++i) {
+        if (const auto d = slots[i].delta.exchange(0, std::memory_order_acq_rel); d != 0) {
+            sending.fetch_add(d, std::memory_order_acq_rel);
+            total += d;
+        }
+    }
+    if (total == 0) {
+        return ok(last.load(std::memory_order_acquire));
+    }
+    ++counters.flushes;
+    const auto r = internal::process<result::integer>::run(connection, "INCRBY", key, total);
+    if (r.is_error()) {
+        ++counters.failures;
+        // keep it for the next flush
+        slots[0].delta.fetch_add(total, std::memory_order_relaxed);
+        sending.fetch_sub(total, std::memory_order_acq_rel);
+        return failed(r.error_value());
+    }
+    last.store(r.unwrap().message(), std::memory_order_release);
+    sending.fetch_sub(total, std::memory_order_acq_rel);
+    return ok(r.unwrap().message());
+}
+
+auto aggregated_counter::statistics() const -> stats
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return counters;
+}
+
+}   // end of namespace redis
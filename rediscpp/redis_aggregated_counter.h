@@ -0,0 +1,108 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include "rediscpp/internal/worker.h"
+#include "result/results.h"
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+/**
+ * long_int is doing a round trip to the server for each change, which is too slow for
+ * metrics that are changed many times a second. The aggregated counter is only adding
+ * the changes locally, into one of a few slots (each on its own cache line, and each
+ * thread is using its own slot, so threads are not fighting over the same memory), and
+ * a background thread is sending the sum of the changes with INCRBY on each interval.
+ * The value is only approximated locally - it is the value that the server returned on the last
+ * flush with the changes that were not sent yet, so changes by others are only seen after a flush.
+ * Note that changes that were not sent yet are lost if the process crashes, and if a flush
+ * fails, its changes are kept and sent on the next flush.
+ * The INCRBY is sent over the end point that is given here, mostly from the background thread,
+ * so each counter needs an end point of its own - even two counters cannot share one.
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        aggregated_counter::options opts;
+        opts.interval = std::chrono::milliseconds{200};
+        aggregated_counter requests(connection, "requests", opts);
+        // from any thread
+        ++requests;
+        requests += 10;
+        std::cout<<"about "<<requests.read_approx()<<" requests"<<std::endl;
+    */
+    struct aggregated_counter
+    {
+        using value_type = std::int64_t;
+        using milliseconds_t = end_point::milliseconds_t;
+        using result_t = ::result<value_type, std::string>;
+
+        struct options
+        {
+            milliseconds_t interval = milliseconds_t{100};  // the time between flushes
+            std::size_t slots = 0;                          // the number of slots, 0 for the number of cores
+        };
+
+        struct stats
+        {
+            std::uint64_t flushes = 0;      // the number of INCRBY that we sent
+            std::uint64_t failures = 0;     // flushes that failed, their changes are sent with the next flush
+        };
+
+        // throws connection_error if we cannot read the current value
+        aggregated_counter(end_point ep, std::string name);
+
+        aggregated_counter(end_point ep, std::string name, options opts);
+
+        // the changes that were not sent yet are sent before this returns
+        ~aggregated_counter();
+
+        aggregated_counter(const aggregated_counter&) = delete;
+        aggregated_counter& operator = (const aggregated_counter&) = delete;
+
+        // these can be called from any thread, and they are never talking to the server
+        auto add(value_type by) -> void;
+
+        auto operator ++ () -> aggregated_counter&;
+
+        auto operator -- () -> aggregated_counter&;
+
+        auto operator += (value_type by) -> aggregated_counter&;
+
+        auto operator -= (value_type by) -> aggregated_counter&;
+
+        // the value at the server on the last flush with the local changes since then
+        auto read_approx() const -> value_type;
+
+        // send the changes now, return the value at the server after them
+        auto flush() -> result_t;
+
+        auto statistics() const -> stats;
+
+    private:
+        static constexpr std::size_t CACHE_LINE = 64;
+
+        struct alignas(CACHE_LINE) slot
+        {
+            std::atomic<value_type> delta{0};
+        };
+
+        mutable end_point connection;
+        std::string key;
+        options config;
+        std::unique_ptr<slot[]> slots;
+        std::size_t mask = 0;
+        std::atomic<value_type> last{0};        // the value that the server returned on the last flush
+        std::atomic<value_type> sending{0};     // changes that were taken from the slots, and are not in last yet
+        mutable std::mutex lock;                // only one flush at a time
+        stats counters;
+        std::mutex idle;                        // the background thread is waiting on it
+        internal::worker::clock_type::time_point next_flush;    // only used by the background thread
+        internal::worker flusher{idle};
+    };
+}   // end of namespace redis
+
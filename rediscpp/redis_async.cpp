@@ -0,0 +1,554 @@
+#include "redis_async.h"
+#include <hiredis/hiredis.h>
+#include <hiredis/async.h>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+
+namespace redis
+{
+
+using namespace std::string_literals;
+
+namespace details
+{
+
+// this is the glue between hiredis async context and boost asio - hiredis is telling us
+// when it wants to read or write on the socket, and we are calling it back once the socket
+// is ready for it
+struct async_connection : std::enable_shared_from_this<async_connection>
+{
+    explicit async_connection(boost::asio::io_context& ioc) : io{ioc}, socket{ioc} {
+    }
+
+    ~async_connection() {
+        if (context) {
+            context->data = nullptr;    // make sure the callbacks would not use us anymore
+            redisAsyncFree(context);
+        }
+    }
+
+    auto attach(redisAsyncContext* ac, const std::string& target) -> void {
+        if (!ac) {
+            lost = "failed to allocate connection to " + target;
+            return;
+        }
+        if (ac->err) {
+            lost = "failed to connect to " + target + ": " + ac->errstr;
+            redisAsyncFree(ac);
+            return;
+        }
+        context = ac;
+        context->data = this;
+        context->ev.data = this;
+        context->ev.addRead = [](void* p) {
+            auto self = static_cast<async_connection*>(p);
+            self->want_read = true;
+            self->arm_read();
+        };
+        context->ev.delRead = [](void* p) {
+            static_cast<async_connection*>(p)->want_read = false;
+        };
+        context->ev.addWrite = [](void* p) {
+            auto self = static_cast<async_connection*>(p);
+            self->want_write = true;
+            self->arm_write();
+        };
+        context->ev.delWrite = [](void* p) {
+            static_cast<async_connection*>(p)->want_write = false;
+        };
+        context->ev.cleanup = [](void* p) {
+            static_cast<async_connection*>(p)->detach();
+        };
+        redisAsyncSetConnectCallback(context, [](const redisAsyncContext* c, int status) {
+            if (status != REDIS_OK && c->data) {
+                static_cast<async_connection*>(c->data)->lost = "failed to connect: "s + c->errstr;
+            }
+        });
+        redisAsyncSetDisconnectCallback(context, [](const redisAsyncContext* c, int status) {
+            if (c->data) {
+                static_cast<async_connection*>(c->data)->lost = status == REDIS_OK ?
+                        "connection was closed"s : "connection was lost: "s + c->errstr;
+            }
+        });
+        socket.assign(context->c.fd);
+    }
+
+    // hiredis is about to free the context - this is the last time we see it
+    auto detach() -> void {
+        want_read = want_write = false;
+        boost::system::error_code ec;
+        socket.cancel(ec);
+        socket.release();   // hiredis is the one closing the socket
+        context = nullptr;
+        if (lost.empty()) {
+            lost = "connection was closed"s;
+        }
+    }
+
+    auto arm_read() -> void {
+        if (read_armed || !want_read || !context) {
+            return;
+        }
+        read_armed = true;
+        socket.async_wait(boost::asio::posix::stream_descriptor::wait_read, [w = weak_from_this()](const auto& ec) {
+            if (auto self = w.lock(); self) {
+                self->read_armed = false;
+                if (!ec && self->context) {
+                    redisAsyncHandleRead(self->context);
+                    self->arm_read();
+                }
+            }
+        });
+    }
+
+    auto arm_write() -> void {
+        if (write_armed || !want_write || !context) {
+            return;
+        }
+        write_armed = true;
+        socket.async_wait(boost::asio::posix::stream_descriptor::wait_write, [w = weak_from_this()](const auto& ec) {
+            if (auto self = w.lock(); self) {
+                self->write_armed = false;
+                if (!ec && self->context) {
+                    redisAsyncHandleWrite(self->context);
+                    self->arm_write();
+                }
+            }
+        });
+    }
+
+    boost::asio::io_context& io;
+    boost::asio::posix::stream_descriptor socket;
+    redisAsyncContext* context = nullptr;
+    bool want_read = false;
+    bool want_write = false;
+    bool read_armed = false;
+    bool write_armed = false;
+    std::string lost;
+};
+
+namespace
+{
+
+auto on_reply(redisAsyncContext*, void* reply, void* privdata) -> void
+{
+    std::unique_ptr<std::shared_ptr<async_request>> request{static_cast<std::shared_ptr<async_request>*>(privdata)};
+    if (reply) {
+        (*request)->complete(static_cast<const redisReply*>(reply));
+    } else {
+        (*request)->fail("connection lost before reply arrived"s);
+    }
+}
+
+auto error_of(const redisReply* r) -> std::optional<std::string>
+{
+    if (!r) {
+        return "no reply from the server"s;
+    }
+    if (r->type == REDIS_REPLY_ERROR) {
+        return "redis error: "s + std::string(r->str, r->len);
+    }
+    return std::nullopt;
+}
+
+auto mismatch(const redisReply* r) -> std::string
+{
+    return "unexpected reply type " + std::to_string(r->type);
+}
+
+}   // end of local namespace
+
+auto submit(const std::shared_ptr<async_connection>& c, const std::vector<std::string>& args,
+        std::shared_ptr<async_request> request) -> void
+{
+    if (!c || !c->context) {
+        request->fail(c && !c->lost.empty() ? c->lost : "not connected"s);
+        return;
+    }
+    std::vector<const char*> argv;
+    std::vector<std::size_t> lengths;
+    argv.reserve(args.size());
+    lengths.reserve(args.size());
+    for (const auto& a : args) {
+        argv.push_back(a.data());
+        lengths.push_back(a.size());
+    }
+    auto privdata = new std::shared_ptr<async_request>(request);
+    if (redisAsyncCommandArgv(c->context, on_reply, privdata, static_cast<int>(args.size()), argv.data(), lengths.data()) != REDIS_OK) {
+        delete privdata;
+        request->fail("failed to send command to the server"s);
+    }
+}
+
+auto resume(async_request& request) -> void
+{
+    if (request.waiter) {
+        boost::asio::post(request.connection->io, [h = request.waiter]() {
+            h.resume();
+        });
+    }
+}
+
+template<>
+auto decode<std::string>(const redisReply* r) -> ::result<std::string, std::string>
+{
+    if (const auto e = error_of(r); e) {
+        return failed(e.value());
+    }
+    if (r->type == REDIS_REPLY_STRING || r->type == REDIS_REPLY_STATUS) {
+        return ok(std::string(r->str, r->len));
+    }
+    if (r->type == REDIS_REPLY_NIL) {
+        return ok(std::string{});
+    }
+    return failed(mismatch(r));
+}
+
+template<>
+auto decode<std::optional<std::string>>(const redisReply* r) -> ::result<std::optional<std::string>, std::string>
+{
+    if (r && r->type == REDIS_REPLY_NIL) {
+        return ok(std::optional<std::string>{});
+    }
+    return decode<std::string>(r).and_then([](auto&& s) -> ::result<std::optional<std::string>, std::string> {
+        return ok(std::optional<std::string>{std::move(s)});
+    });
+}
+
+template<>
+auto decode<std::int64_t>(const redisReply* r) -> ::result<std::int64_t, std::string>
+{
+    if (const auto e = error_of(r); e) {
+        return failed(e.value());
+    }
+    switch (r->type) {
+        case REDIS_REPLY_INTEGER:
+            return ok(static_cast<std::int64_t>(r->integer));
+        case REDIS_REPLY_NIL:
+            return ok(std::int64_t{0});
+        case REDIS_REPLY_STRING:
+            try {
+                return ok(static_cast<std::int64_t>(std::stoll(std::string(r->str, r->len))));
+            } catch (const std::exception&) {
+                return failed("value is not an integer"s);
+            }
+        default:
+            return failed(mismatch(r));
+    }
+}
+
+template<>
+auto decode<bool>(const redisReply* r) -> ::result<bool, std::string>
+{
+    if (const auto e = error_of(r); e) {
+        return failed(e.value());
+    }
+    switch (r->type) {
+        case REDIS_REPLY_STATUS:
+            return ok(boost::algorithm::iequals(std::string_view(r->str, r->len), "ok"));
+        case REDIS_REPLY_INTEGER:
+            return ok(r->integer >= 0);
+        case REDIS_REPLY_NIL:
+            return ok(false);
+        default:
+            return failed(mismatch(r));
+    }
+}
+
+template<>
+auto decode<std::vector<std::string>>(const redisReply* r) -> ::result<std::vector<std::string>, std::string>
+{
+    if (const auto e = error_of(r); e) {
+        return failed(e.value());
+    }
+    if (r->type != REDIS_REPLY_ARRAY) {
+        return failed(mismatch(r));
+    }
+    std::vector<std::string> out;
+    out.reserve(r->elements);
+    for (std::size_t i = 0; i < r->elements; ++i) {
+        const auto e = r->element[i];
+        out.emplace_back(e->str ? std::string(e->str, e->len) : std::string{});
+    }
+    return ok(std::move(out));
+}
+
+template<>
+auto decode<std::vector<std::pair<std::string, std::string>>>(const redisReply* r) ->
+    ::result<std::vector<std::pair<std::string, std::string>>, std::string>
+{
+    using entries_type = std::vector<std::pair<std::string, std::string>>;
+
+    return decode<std::vector<std::string>>(r).and_then([](auto&& flat) -> ::result<entries_type, std::string> {
+        entries_type out;
+        out.reserve(flat.size() / 2);
+        for (std::size_t i = 0; i + 1 < flat.size(); i += 2) {
+            out.emplace_back(std::move(flat[i]), std::move(flat[i + 1]));
+        }
+        return ok(std::move(out));
+    });
+}
+
+auto cancel_state::add(std::weak_ptr<async_request> request) -> void
+{
+    // a token may be used for many requests over a long time, so once in a while we drop the
+    // requests that are gone - the next time is after it doubled again, so this is amortized
+    if (waiting.size() >= prune_at) {
+        waiting.erase(std::remove_if(waiting.begin(), waiting.end(), [](const auto& w) {
+            return w.expired();
+        }), waiting.end());
+        prune_at = std::max(MIN_PRUNE, waiting.size() * 2);
+    }
+    waiting.push_back(std::move(request));
+}
+
+}   // end of namespace details
+
+///////////////////////////////////////////////////////////////////////////////
+
+cancel_token::cancel_token(std::shared_ptr<details::cancel_state> s) : state{std::move(s)}
+{
+}
+
+auto cancel_token::cancelled() const -> bool
+{
+    if (!state) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard{state->lock};
+    return state->cancelled;
+}
+
+cancel_source::cancel_source() : state{std::make_shared<details::cancel_state>()}
+{
+}
+
+auto cancel_source::token() const -> cancel_token
+{
+    return cancel_token{state};
+}
+
+auto cancel_source::cancel() -> void
+{
+    std::vector<std::weak_ptr<details::async_request>> waiting;
+    {
+        std::lock_guard<std::mutex> guard{state->lock};
+        state->cancelled = true;
+        waiting.swap(state->waiting);
+    }
+    for (auto& w : waiting) {
+        if (auto r = w.lock(); r) {
+            r->fail("operation was cancelled"s);
+        }
+    }
+}
+
+auto cancel_source::cancelled() const -> bool
+{
+    std::lock_guard<std::mutex> guard{state->lock};
+    return state->cancelled;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+async_end_point::async_end_point(boost::asio::io_context& io, const std::string& host, std::uint16_t port) :
+    connection{std::make_shared<details::async_connection>(io)}
+{
+    connection->attach(redisAsyncConnect(host.c_str(), port), host + ":" + std::to_string(port));
+    if (!connection->context) {
+        throw connection_error(connection->lost);
+    }
+}
+
+async_end_point::async_end_point(boost::asio::io_context& io, end_point::named_pipe_t pipe) :
+    connection{std::make_shared<details::async_connection>(io)}
+{
+    connection->attach(redisAsyncConnectUnix(pipe.name.c_str()), pipe.name);
+    if (!connection->context) {
+        throw connection_error(connection->lost);
+    }
+}
+
+auto async_end_point::close() -> void
+{
+    if (connection->context) {
+        redisAsyncDisconnect(connection->context);
+    }
+}
+
+auto async_end_point::error() const -> std::string
+{
+    return connection->lost;
+}
+
+async_end_point::operator bool () const
+{
+    return connection->context != nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+async_rstring::async_rstring(async_end_point ep, std::string name) : connection{std::move(ep)}, key_name{std::move(name)}
+{
+}
+
+auto async_rstring::get() const -> async_op<std::optional<std::string>>
+{
+    return connection.command<std::optional<std::string>>({"GET"s, key_name});
+}
+
+auto async_rstring::set(std::string_view value) const -> async_op<bool>
+{
+    return connection.command<bool>({"SET"s, key_name, std::string{value}});
+}
+
+auto async_rstring::append(std::string_view value) const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"APPEND"s, key_name, std::string{value}});
+}
+
+auto async_rstring::size() const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"STRLEN"s, key_name});
+}
+
+auto async_rstring::range(std::int64_t from, std::int64_t to) const -> async_op<std::string>
+{
+    return connection.command<std::string>({"GETRANGE"s, key_name, std::to_string(from), std::to_string(to)});
+}
+
+auto async_rstring::erase() const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"DEL"s, key_name});
+}
+
+async_rmap::async_rmap(async_end_point ep) : connection{std::move(ep)}
+{
+}
+
+auto async_rmap::find(std::string_view key) const -> async_op<std::optional<std::string>>
+{
+    return connection.command<std::optional<std::string>>({"GET"s, std::string{key}});
+}
+
+auto async_rmap::insert(std::string_view key, std::string_view value) const -> async_op<bool>
+{
+    return connection.command<bool>({"SET"s, std::string{key}, std::string{value}});
+}
+
+auto async_rmap::erase(std::string_view key) const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"DEL"s, std::string{key}});
+}
+
+auto async_rmap::size() const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"DBSIZE"s});
+}
+
+async_long_int::async_long_int(async_end_point ep, std::string n) : connection{std::move(ep)}, name{std::move(n)}
+{
+}
+
+auto async_long_int::get() const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"GET"s, name});
+}
+
+auto async_long_int::set(std::int64_t value) const -> async_op<bool>
+{
+    return connection.command<bool>({"SET"s, name, std::to_string(value)});
+}
+
+auto async_long_int::increment() const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"INCR"s, name});
+}
+
+auto async_long_int::decrement() const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"DECR"s, name});
+}
+
+auto async_long_int::add(std::int64_t by) const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"INCRBY"s, name, std::to_string(by)});
+}
+
+auto async_long_int::subtract(std::int64_t by) const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"DECRBY"s, name, std::to_string(by)});
+}
+
+async_rarray::async_rarray(async_end_point ep, std::string n) : connection{std::move(ep)}, name{std::move(n)}
+{
+}
+
+auto async_rarray::push_back(std::string_view value) const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"RPUSH"s, name, std::string{value}});
+}
+
+auto async_rarray::push_front(std::string_view value) const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"LPUSH"s, name, std::string{value}});
+}
+
+auto async_rarray::at(std::int64_t index) const -> async_op<std::optional<std::string>>
+{
+    return connection.command<std::optional<std::string>>({"LINDEX"s, name, std::to_string(index)});
+}
+
+auto async_rarray::range(std::int64_t from, std::int64_t to) const -> async_op<std::vector<std::string>>
+{
+    return connection.command<std::vector<std::string>>({"LRANGE"s, name, std::to_string(from), std::to_string(to)});
+}
+
+auto async_rarray::size() const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"LLEN"s, name});
+}
+
+auto async_rarray::erase() const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"DEL"s, name});
+}
+
+async_rmmap::async_rmmap(async_end_point ep, std::string primary_key) : connection{std::move(ep)}, pkey{std::move(primary_key)}
+{
+}
+
+auto async_rmmap::find(std::string_view key) const -> async_op<std::optional<std::string>>
+{
+    return connection.command<std::optional<std::string>>({"HGET"s, pkey, std::string{key}});
+}
+
+auto async_rmmap::insert(std::string_view key, std::string_view value) const -> async_op<bool>
+{
+    return connection.command<bool>({"HSET"s, pkey, std::string{key}, std::string{value}});
+}
+
+auto async_rmmap::erase(std::string_view key) const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"HDEL"s, pkey, std::string{key}});
+}
+
+auto async_rmmap::size() const -> async_op<std::int64_t>
+{
+    return connection.command<std::int64_t>({"HLEN"s, pkey});
+}
+
+auto async_rmmap::keys() const -> async_op<std::vector<std::string>>
+{
+    return connection.command<std::vector<std::string>>({"HKEYS"s, pkey});
+}
+
+auto async_rmmap::entries() const -> async_op<entries_type>
+{
+    return connection.command<entries_type>({"HGETALL"s, pkey});
+}
+
+}   // end of namespace redis
+
@@ -0,0 +1,329 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include "redis_task.h"
+#include "result/results.h"
+#include <boost/asio/io_context.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <coroutine>
+#include <cstdint>
+#include <utility>
+
+/**
+ * asynchronous version of the end_point. All the operations here are not blocking
+ * the calling thread, instead they are returning an object that can be awaited from
+ * a coroutine (see redis_task.h). The networking is driven by boost asio io_context, so
+ * the thread (or threads) that are running the io_context are the ones that would resume
+ * the coroutines once the reply from the server arrived. With this a single thread can have
+ * many requests in flight at the same time.
+ * Note that the async end point is not thread safe, all the operations on it must be
+ * done from the thread (or strand) that is running the io_context.
+ **/
+
+struct redisReply;
+
+namespace redis
+{
+    /* usage:
+        boost::asio::io_context io;
+        async_end_point connection(io, "localhost");
+        async_rmap map(connection);
+        cancel_source stop;
+        spawn([&]() -> task<> {
+            auto inserted = co_await map.insert("foo", "bar");
+            auto value = co_await map.find("foo").cancel_on(stop.token());
+            if (value.is_ok() && value.unwrap()) {
+                std::cout<<"foo = "<<*value.unwrap()<<std::endl;
+            }
+        }());
+        io.run();
+    */
+    struct async_end_point;
+
+    namespace details
+    {
+        struct async_connection;
+
+        // single request that was sent to the server, waiting for reply
+        struct async_request
+        {
+            virtual ~async_request() = default;
+
+            // reply from the server - null if we lost the connection
+            virtual auto complete(const redisReply* reply) -> void = 0;
+
+            virtual auto fail(std::string error) -> void = 0;
+
+            std::atomic<bool> done{false};
+            std::coroutine_handle<> waiter;
+            std::shared_ptr<async_connection> connection;
+        };
+
+        struct cancel_state
+        {
+            // called with the lock held - requests that already completed are dropped from here
+            auto add(std::weak_ptr<async_request> request) -> void;
+
+            std::mutex lock;
+            bool cancelled = false;
+            std::vector<std::weak_ptr<async_request>> waiting;
+
+            static constexpr std::size_t MIN_PRUNE = 16;
+            std::size_t prune_at = MIN_PRUNE;       // the size of waiting when we drop the ones that completed
+        };
+
+        // convert the reply from the server to the type that the operation returns,
+        // this is implemented for std::string, std::optional<std::string>, std::int64_t, bool,
+        // std::vector<std::string> and std::vector<std::pair<std::string, std::string>>
+        template<typename T>
+        auto decode(const redisReply* reply) -> ::result<T, std::string>;
+
+        auto submit(const std::shared_ptr<async_connection>& c, const std::vector<std::string>& args,
+                std::shared_ptr<async_request> request) -> void;
+
+        // resume the waiting coroutine from the io_context (never from inside hiredis callback)
+        auto resume(async_request& request) -> void;
+
+        template<typename T>
+        struct typed_request : async_request
+        {
+            auto complete(const redisReply* reply) -> void override {
+                if (!done.exchange(true)) {
+                    value.emplace(decode<T>(reply));
+                    resume(*this);
+                }
+            }
+
+            auto fail(std::string error) -> void override {
+                if (!done.exchange(true)) {
+                    value.emplace(failed(std::move(error)));
+                    resume(*this);
+                }
+            }
+
+            std::optional<::result<T, std::string>> value;
+        };
+    }   // end of namespace details
+
+    struct cancel_token
+    {
+        cancel_token() = default;
+
+        auto cancelled() const -> bool;
+
+    private:
+        friend struct cancel_source;
+        template<typename T> friend struct async_op;
+
+        explicit cancel_token(std::shared_ptr<details::cancel_state> s);
+
+        std::shared_ptr<details::cancel_state> state;
+    };
+
+    // this would cancel all the operations that were awaited with the tokens taken from it.
+    // Cancelled operation would resume its coroutine with an error. The server may still
+    // execute the command, but its reply would be ignored
+    struct cancel_source
+    {
+        cancel_source();
+
+        auto token() const -> cancel_token;
+
+        auto cancel() -> void;
+
+        auto cancelled() const -> bool;
+
+    private:
+        std::shared_ptr<details::cancel_state> state;
+    };
+
+    // the result of an asynchronous operation - the command is only sent when this is awaited
+    template<typename T>
+    struct async_op
+    {
+        using value_type = T;
+        using result_type = ::result<T, std::string>;
+
+        async_op(std::shared_ptr<details::async_connection> c, std::vector<std::string> a) :
+            connection{std::move(c)}, args{std::move(a)} {
+        }
+
+        // the operation would be cancelled when the source of this token is cancelled
+        auto cancel_on(cancel_token t) && -> async_op&& {
+            token = std::move(t);
+            return std::move(*this);
+        }
+
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+
+        auto await_suspend(std::coroutine_handle<> h) -> bool {
+            using namespace std::string_literals;
+
+            request = std::make_shared<details::typed_request<T>>();
+            request->waiter = h;
+            request->connection = connection;
+            if (token.state) {
+                std::lock_guard<std::mutex> guard{token.state->lock};
+                if (token.state->cancelled) {
+                    request->done = true;
+                    request->value.emplace(failed("operation was cancelled"s));
+                    return false;   // no need to suspend
+                }
+                token.state->add(request);
+            }
+            details::submit(connection, args, request);
+            return true;
+        }
+
+        auto await_resume() -> result_type {
+            return std::move(*request->value);
+        }
+
+    private:
+        std::shared_ptr<details::async_connection> connection;
+        std::vector<std::string> args;
+        cancel_token token;
+        std::shared_ptr<details::typed_request<T>> request;
+    };
+
+    struct async_end_point
+    {
+        async_end_point(boost::asio::io_context& io, const std::string& host, std::uint16_t port = end_point::DEFAULT_PORT);
+
+        async_end_point(boost::asio::io_context& io, end_point::named_pipe_t pipe);
+
+        // run any command - for example
+        // co_await ep.command<std::int64_t>({"INCRBY", "my counter", "10"});
+        template<typename T>
+        auto command(std::vector<std::string> args) const -> async_op<T> {
+            return async_op<T>{connection, std::move(args)};
+        }
+
+        // disconnect from the server once all the pending replies arrived
+        auto close() -> void;
+
+        // return the reason we lost the connection, empty if we are connected
+        auto error() const -> std::string;
+
+        explicit operator bool () const;
+
+    private:
+        std::shared_ptr<details::async_connection> connection;
+    };
+
+    // asynchronous version of rstring (see redis_messages.h)
+    struct async_rstring
+    {
+        async_rstring(async_end_point ep, std::string name);
+
+        auto get() const -> async_op<std::optional<std::string>>;
+
+        auto set(std::string_view value) const -> async_op<bool>;
+
+        auto append(std::string_view value) const -> async_op<std::int64_t>;    // return the new length
+
+        auto size() const -> async_op<std::int64_t>;
+
+        auto range(std::int64_t from, std::int64_t to) const -> async_op<std::string>;
+
+        auto erase() const -> async_op<std::int64_t>;
+
+    private:
+        async_end_point connection;
+        std::string key_name;
+    };
+
+    // asynchronous version of rmap (see redis_messages.h)
+    struct async_rmap
+    {
+        explicit async_rmap(async_end_point ep);
+
+        auto find(std::string_view key) const -> async_op<std::optional<std::string>>;
+
+        auto insert(std::string_view key, std::string_view value) const -> async_op<bool>;
+
+        auto erase(std::string_view key) const -> async_op<std::int64_t>;
+
+        auto size() const -> async_op<std::int64_t>;
+
+    private:
+        async_end_point connection;
+    };
+
+    // asynchronous version of long_int (see redis_messages.h)
+    struct async_long_int
+    {
+        async_long_int(async_end_point ep, std::string name);
+
+        auto get() const -> async_op<std::int64_t>;
+
+        auto set(std::int64_t value) const -> async_op<bool>;
+
+        auto increment() const -> async_op<std::int64_t>;
+
+        auto decrement() const -> async_op<std::int64_t>;
+
+        auto add(std::int64_t by) const -> async_op<std::int64_t>;
+
+        auto subtract(std::int64_t by) const -> async_op<std::int64_t>;
+
+    private:
+        async_end_point connection;
+        std::string name;
+    };
+
+    // asynchronous version of rarray (see redis_messages.h)
+    struct async_rarray
+    {
+        async_rarray(async_end_point ep, std::string name);
+
+        auto push_back(std::string_view value) const -> async_op<std::int64_t>;
+
+        auto push_front(std::string_view value) const -> async_op<std::int64_t>;
+
+        auto at(std::int64_t index) const -> async_op<std::optional<std::string>>;
+
+        auto range(std::int64_t from = 0, std::int64_t to = -1) const -> async_op<std::vector<std::string>>;
+
+        auto size() const -> async_op<std::int64_t>;
+
+        auto erase() const -> async_op<std::int64_t>;
+
+    private:
+        async_end_point connection;
+        std::string name;
+    };
+
+    // asynchronous version of rmmap_proxy (see redis_multimap.h) - all the entries under a primary key
+    struct async_rmmap
+    {
+        using entries_type = std::vector<std::pair<std::string, std::string>>;
+
+        async_rmmap(async_end_point ep, std::string primary_key);
+
+        auto find(std::string_view key) const -> async_op<std::optional<std::string>>;
+
+        auto insert(std::string_view key, std::string_view value) const -> async_op<bool>;
+
+        auto erase(std::string_view key) const -> async_op<std::int64_t>;
+
+        auto size() const -> async_op<std::int64_t>;
+
+        auto keys() const -> async_op<std::vector<std::string>>;
+
+        auto entries() const -> async_op<entries_type>;
+
+    private:
+        async_end_point connection;
+        std::string pkey;
+    };
+}   // end of namespace redis
+
@@ -0,0 +1,159 @@
+#include "redis_background_subscriber.h"
+#include "rediscpp/internal/commands.h"
+#include "rediscpp/internal/pubsub.h"
+#include <chrono>
+
+namespace redis
+{
+
+using namespace std::string_literals;
+
+namespace
+{
+    constexpr int SPINS_BEFORE_SLEEP = 64;
+    constexpr auto FULL_QUEUE_SLEEP = std::chrono::microseconds{50};
+}   // end of local namespace
+
+background_subscriber::background_subscriber(const channel& c) :
+    background_subscriber(c, options{})
+{
+}
+
+background_subscriber::background_subscriber(const channel& c, options opts) :
+    comm{c}, config{opts}, queue{opts.capacity}
+{
+    if (!comm.by()) {
+        throw connection_error("trying to create subscriber with invalid redis endpoint object");
+    }
+    if (buffers(comm.by()).route) {
+        throw connection_error("cannot subscribe over cluster or replicated end point, use direct connection to the node");
+    }
+    if (const auto e = Error(internal::process<void>::run(comm.by(), internal::pubsub::subscribe_command(comm.sharded()), comm.name())); e) {
+        throw connection_error("failed to subscribe to " + std::string(comm.name()) + ": " + e.value());
+    }
+    reader = std::thread([this]() { run(); });
+}
+
+background_subscriber::~background_subscriber()
+{
+    stop();
+    if (reader.joinable()) {
+        reader.join();
+    }
+    if (comm.by()) {
+        // we are not waiting for the reply, we are not going to read from this anymore
+        auto& request = buffers(comm.by()).out;
+        request.clear();
+        request.command(internal::pubsub::unsubscribe_command(comm.sharded()), comm.name());
+        internal::resp::send(comm.by(), request.data());
+    }
+}
+
+auto background_subscriber::run() -> void
+{
+    auto& ep = comm.by();
+    auto& in = buffers(ep).in;
+    std::optional<std::string> e;
+    while (!stopped) {
+        const auto r = in.next();
+        if (r.is_error()) {
+            e = r.error_value();
+            break;
+        }
+        if (const auto& reply = r.unwrap(); reply) {
+            const auto event = internal::pubsub::classify(*reply, comm.sharded());
+            if (event.kind == internal::pubsub::event::MESSAGE) {
+                ++received;
+                deliver(event.payload);
+            } else if (event.kind == internal::pubsub::event::UNSUBSCRIBED) {
+                e = "the slot of the channel moved to another node"s;
+                break;
+            }
+            continue;
+        }
+        // we only get here after we processed everything that we have so far
+        if (const auto f = internal::resp::fill(ep, end_point::milliseconds_t{-1}, wake.handle()); f.is_error()) {
+            e = f.error_value();
+            break;
+        }
+        wake.consume();
+    }
+    if (e) {
+        std::lock_guard<std::mutex> guard(lock);
+        failure = std::move(e);
+    }
+    done = true;
+}
+
+auto background_subscriber::deliver(std::string_view message) -> void
+{
+    const auto fill = [message](std::string& into) {
+        into.assign(message.data(), message.size());    // reuse the memory of the slot
+    };
+    int spins = 0;
+    while (!queue.try_push(fill)) {
+        switch (config.overflow) {
+            case overflow_t::DROP_NEWEST:
+                ++dropped;
+                return;
+            case overflow_t::DROP_OLDEST:
+                if (queue.try_pop([](std::string&) {})) {
+                    ++dropped;
+                }
+                break;
+            case overflow_t::BLOCK:
+                if (stopped) {
+                    return;
+                }
+                if (++spins < SPINS_BEFORE_SLEEP) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(FULL_QUEUE_SLEEP);
+                }
+                break;
+        }
+    }
+}
+
+auto background_subscriber::try_read() -> std::optional<std::string>
+{
+    std::optional<std::string> out;
+    if (queue.try_pop([&out](std::string& from) { out.emplace(std::move(from)); })) {
+        ++delivered;
+    }
+    return out;
+}
+
+auto background_subscriber::read_batch(std::span<std::string> into) -> std::size_t
+{
+    std::size_t count = 0;
+    while (count < into.size() && queue.try_pop([&into, count](std::string& from) { into[count].swap(from); })) {
+        ++count;
+    }
+    delivered += count;
+    return count;
+}
+
+auto background_subscriber::running() const -> bool
+{
+    return !done;
+}
+
+auto background_subscriber::error() const -> std::optional<std::string>
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return failure;
+}
+
+auto background_subscriber::stop() -> void
+{
+    stopped = true;
+    wake.notify();
+}
+
+auto background_subscriber::statistics() const -> stats
+{
+    return stats{received.load(), delivered.load(), dropped.load(), queue.size()};
+}
+
+}   // end of namespace redis
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "redis_channel.h"
+#include "rediscpp/internal/ring.h"
+#include "rediscpp/internal/wakeup.h"
+#include <string>
+#include <span>
+#include <optional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+/**
+ * the subscriber (see redis_channel.h) is reading from the socket on the thread that is calling
+ * read, and copies each message into a new string. The background subscriber has its own
+ * thread that reads from the socket as much as is available, and place the messages in a
+ * bounded lock free queue. The consumer is taking the messages from the queue without any
+ * system call, and with read_batch the strings are swapped with the ones that the queue
+ * holds, so once this is warmed up, there are no allocations for the messages.
+ * When the consumer is slower than the publisher and the queue is full, we can either
+ * wait for it (and then the messages are buffered by the server), or drop messages.
+ * Note that only one thread should read from the queue, and the end point is used
+ * only by the background thread while this is alive.
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        channel messages("my channel", connection);
+        background_subscriber::options opts;
+        opts.capacity = 64 * 1024;
+        opts.overflow = background_subscriber::overflow_t::DROP_OLDEST;
+        background_subscriber reader(messages, opts);
+        std::vector<std::string> batch(256);
+        while (reader.running()) {
+            const auto n = reader.read_batch(batch);
+            for (std::size_t i = 0; i < n; ++i) {
+                process(batch[i]);
+            }
+            if (n == 0) {
+                // nothing to do now..
+            }
+        }
+    */
+    struct background_subscriber
+    {
+        enum class overflow_t
+        {
+            BLOCK,          // wait for the consumer to make room
+            DROP_OLDEST,    // make room by removing the oldest message in the queue
+            DROP_NEWEST     // drop the message that we just read
+        };
+
+        struct options
+        {
+            std::size_t capacity = 4096;    // rounded up to power of 2
+            overflow_t overflow = overflow_t::BLOCK;
+        };
+
+        struct stats
+        {
+            std::uint64_t received = 0;     // messages that were read from the server
+            std::uint64_t delivered = 0;    // messages that the consumer took
+            std::uint64_t dropped = 0;      // messages that were lost since the queue was full
+            std::size_t depth = 0;          // messages that are waiting in the queue
+        };
+
+        explicit background_subscriber(const channel& c);
+
+        background_subscriber(const channel& c, options opts);
+
+        // stop the background thread and unsubscribe
+        ~background_subscriber();
+
+        background_subscriber(const background_subscriber&) = delete;
+        background_subscriber& operator = (const background_subscriber&) = delete;
+
+        // return the next message if there is any, without waiting
+        auto try_read() -> std::optional<std::string>;
+
+        // move up to into.size() messages into the given strings, without waiting. Return the
+        // number of messages that were read. The strings that were passed in are given to the queue
+        // to reuse their memory
+        auto read_batch(std::span<std::string> into) -> std::size_t;
+
+        // false once the background thread is done - either stop was called or the connection failed.
+        // Messages that are already in the queue can still be read
+        auto running() const -> bool;
+
+        // if the background thread stopped because of an error, this is the error
+        auto error() const -> std::optional<std::string>;
+
+        // can be called from any thread, after this no new messages are added
+        auto stop() -> void;
+
+        auto statistics() const -> stats;
+
+    private:
+        auto run() -> void;
+
+        // place the message in the queue, according to the overflow policy
+        auto deliver(std::string_view message) -> void;
+
+        channel comm;
+        options config;
+        internal::ring<std::string> queue;
+        internal::wakeup wake;
+        std::atomic<bool> stopped{false};
+        std::atomic<bool> done{false};
+        std::atomic<std::uint64_t> received{0};
+        std::atomic<std::uint64_t> delivered{0};
+        std::atomic<std::uint64_t> dropped{0};
+        mutable std::mutex lock;            // for the error
+        std::optional<std::string> failure;
+        std::thread reader;
+    };
+}   // end of namespace redis
+
@@ -0,0 +1,139 @@
+#include "redis_buffered_map.h"
+#include "rediscpp/internal/commands.h"
+#include <vector>
+#include <utility>
+
+namespace redis
+{
+
+buffered_rmap::buffered_rmap(end_point ep) : buffered_rmap(std::move(ep), options{})
+{
+}
+
+buffered_rmap::buffered_rmap(end_point ep, options opts) :
+    connection{std::move(ep)}, store{connection}, config{opts}
+{
+    if (!connection) {
+        throw connection_error("trying to create buffered map with invalid redis endpoint object");
+    }
+    flusher.start([this]() { return due(); }, [this]() { flush(); });
+}
+
+buffered_rmap::~buffered_rmap()
+{
+    flusher.stop();
+    flush();
+}
+
+auto buffered_rmap::write(const key_type& key, std::optional<mapped_type> value) -> bool
+{
+    if (pending.empty()) {
+        first = std::chrono::steady_clock::now();
+    }
+    ++counters.writes;
+    const auto [at, added] = pending.insert_or_assign(key, std::move(value));
+    if (!added) {
+        ++counters.coalesced;
+        return false;       // the size didn't change, so it is still due at the same time
+    }
+    return pending.size() == 1 || pending.size() >= config.max_keys;
+}
+
+auto buffered_rmap::due() const -> internal::worker::clock_type::time_point
+{
+    if (pending.empty()) {
+        return internal::worker::NEVER;
+    }
+    return pending.size() >= config.max_keys ? internal::worker::NOW : first + config.interval;
+}
+
+auto buffered_rmap::insert(const key_type& key, mapped_type value) -> void
+{
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        wake = write(key, std::move(value));
+    }
+    if (wake) {
+        flusher.wake();
+    }
+}
+
+auto buffered_rmap::erase(const key_type& key) -> void
+{
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        wake = write(key, std::nullopt);
+    }
+    if (wake) {
+        flusher.wake();
+    }
+}
+
+auto buffered_rmap::find(const key_type& key) const -> mapped_type
+{
+    // while we are holding this, no flush is in the middle, so if the key is not in the buffer, the server has its last value
+    std::lock_guard<std::mutex> in_order(sending);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (const auto at = pending.find(key); at != pending.end()) {
+            return at->second.value_or(mapped_type{});
+        }
+    }
+    return store.find(key);
+}
+
+auto buffered_rmap::flush() -> bool
+{
+    std::lock_guard<std::mutex> in_order(sending);
+    pending_t batch;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (pending.empty()) {
+            return true;
+        }
+        batch.swap(pending);
+    }
+    std::vector<rmap::value_type> values;
+    std::vector<key_type> removed;
+    values.reserve(batch.size());
+    for (auto& [key, value] : batch) {
+        if (value) {
+            values.emplace_back(key, std::move(*value));
+        } else {
+            removed.push_back(key);
+        }
+    }
+    bool good = true;
+    try {
+        store.insert_many(values, config.chunk);
+    } catch (const connection_error&) {
+        good = false;
+    }
+    if (good && !removed.empty()) {
+        pipeline deletes(connection);
+        for (const auto& key : removed) {
+            internal::queue<void>(deletes, "DEL", key);
+        }
+        good = deletes.exec().is_ok();
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    ++counters.flushes;
+    (good ? counters.flushed : counters.failures) += batch.size();
+    return good;
+}
+
+auto buffered_rmap::size() const -> std::size_t
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return pending.size();
+}
+
+auto buffered_rmap::statistics() const -> stats
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return counters;
+}
+
+}   // end of namespace redis
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "redis_messages.h"
+#include "rediscpp/internal/worker.h"
+#include <string>
+#include <unordered_map>
+#include <optional>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * when the same keys are updated many times a second and only the last value matters, sending
+ * each update to the server is a waste. The buffered map is keeping the writes in memory, where
+ * a write to a key that is already waiting replaces the value that is waiting, and a background
+ * thread is sending all the keys that are waiting (chunked MSET), once the interval passed since the
+ * first write in the buffer, once there are enough keys waiting, or when flush is called.
+ * Reading a key that is waiting returns the value that is waiting.
+ * Note that writes that are in the buffer are lost if the process crashes, and that if a
+ * flush failed the writes in it are dropped (they are counted in the stats).
+ * The flushes are sent from the background thread, and find is reading through the same end
+ * point (in turn with the flushes), so the map should have an end point of its own.
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        buffered_rmap::options opts;
+        opts.interval = std::chrono::milliseconds{50};
+        buffered_rmap positions(connection, opts);
+        for (const auto& update : updates) {
+            positions.insert(update.vehicle, update.position);   // only the last one of each vehicle is sent
+        }
+        std::cout<<positions.find("truck 7")<<std::endl;           // the value that is waiting, if we have one
+        positions.flush();
+    */
+    struct buffered_rmap
+    {
+        using key_type = rmap::key_type;
+        using mapped_type = rmap::mapped_type;
+        using milliseconds_t = end_point::milliseconds_t;
+
+        struct options
+        {
+            milliseconds_t interval = milliseconds_t{10};   // the longest time that a write is waiting in the buffer
+            std::size_t max_keys = 1024;                    // send once we have this many keys waiting
+            std::size_t chunk = rmap::DEFAULT_CHUNK;        // the number of keys in each MSET
+        };
+
+        struct stats
+        {
+            std::uint64_t writes = 0;       // the number of inserts and erases
+            std::uint64_t coalesced = 0;    // writes that replaced a write that was waiting
+            std::uint64_t flushed = 0;      // writes that were sent to the server
+            std::uint64_t flushes = 0;      // the number of times that we sent the buffer
+            std::uint64_t failures = 0;     // writes that we failed to send
+        };
+
+        explicit buffered_rmap(end_point ep);
+
+        buffered_rmap(end_point ep, options opts);
+
+        // whatever is still in the buffer is sent before this returns
+        ~buffered_rmap();
+
+        buffered_rmap(const buffered_rmap&) = delete;
+        buffered_rmap& operator = (const buffered_rmap&) = delete;
+
+        // can be called from any thread
+        auto insert(const key_type& key, mapped_type value) -> void;
+
+        auto erase(const key_type& key) -> void;
+
+        // the value that is waiting to be sent, or the value at the server. throws connection_error on failure
+        auto find(const key_type& key) const -> mapped_type;
+
+        // send whatever is in the buffer now, return false if we failed to send it
+        auto flush() -> bool;
+
+        // the number of keys that are waiting to be sent
+        auto size() const -> std::size_t;
+
+        auto statistics() const -> stats;
+
+    private:
+        // an empty value is a key that we need to remove
+        using pending_t = std::unordered_map<key_type, std::optional<mapped_type>>;
+
+        // must be called with the lock held, return true if the background thread needs to know about it
+        auto write(const key_type& key, std::optional<mapped_type> value) -> bool;
+
+        // when the background thread should send the buffer
+        auto due() const -> internal::worker::clock_type::time_point;
+
+        mutable end_point connection;
+        rmap store;
+        options config;
+        mutable std::mutex lock;                    // for the buffer
+        mutable std::mutex sending;                 // for the end point
+        pending_t pending;
+        std::chrono::steady_clock::time_point first;    // when the first write in the buffer was added
+        stats counters;
+        internal::worker flusher{lock};
+    };
+}   // end of namespace redis
+
@@ -0,0 +1,388 @@
+#include "redis_cached_map.h"
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <stdexcept>
+
+namespace redis
+{
+
+namespace
+{
+    using clock_type = std::chrono::steady_clock;
+
+    // the memory that we are using for each entry, in addition to the key and the value
+    constexpr std::size_t ENTRY_OVERHEAD = 96;
+    // the part of the shard that is used for entries that were read more than once
+    constexpr std::size_t PROTECTED_PERCENT = 80;
+    // the sketch counters are 4 bits, so they are saturated at this
+    constexpr std::uint8_t MAX_COUNT = 15;
+    // the number of counters that we are using for each key
+    constexpr std::size_t SKETCH_DEPTH = 4;
+
+    auto round_up(std::size_t n) -> std::size_t
+    {
+        std::size_t out = 16;
+        while (out < n) {
+            out <<= 1;
+        }
+        return out;
+    }
+
+    // the maps are sharing the cache, so their keys must not collide
+    auto string_key(const std::string& key) -> std::string
+    {
+        return "s" + key;
+    }
+
+    auto field_key(const std::string& key, const std::string& field) -> std::string
+    {
+        return "h" + std::to_string(key.size()) + ":" + key + field;
+    }
+}   // end of local namespace
+
+struct lookup_cache::shard
+{
+    struct entry
+    {
+        std::string key;
+        value_type value;
+        std::size_t hash = 0;
+        std::size_t bytes = 0;
+        clock_type::time_point expires;
+        bool hot = false;               // in the protected segment
+    };
+    using list_type = std::list<entry>;
+
+    // count that the key was read
+    auto touch(std::size_t hash) -> void
+    {
+        for (std::size_t i = 0; i < SKETCH_DEPTH; ++i) {
+            auto& c = sketch[index(hash, i)];
+            if (c < MAX_COUNT) {
+                ++c;
+            }
+        }
+        if (++additions >= reset_at) {
+            // age the counts, so keys that were hot long ago are not kept forever
+            for (auto& c : sketch) {
+                c = static_cast<std::uint8_t>(c >> 1);
+            }
+            additions /= 2;
+        }
+    }
+
+    auto frequency(std::size_t hash) const -> std::uint8_t
+    {
+        auto out = MAX_COUNT;
+        for (std::size_t i = 0; i < SKETCH_DEPTH; ++i) {
+            out = std::min(out, sketch[index(hash, i)]);
+        }
+        return out;
+    }
+
+    auto index(std::size_t hash, std::size_t row) const -> std::size_t
+    {
+        return (hash + row * ((hash >> 17) | 1)) & (sketch.size() - 1);
+    }
+
+    auto remove(list_type::iterator at) -> void
+    {
+        bytes -= at->bytes;
+        if (at->hot) {
+            hot_bytes -= at->bytes;
+        }
+        index_of.erase(at->key);
+        (at->hot ? protect : probation).erase(at);
+    }
+
+    // an entry that is read again is moved to the protected segment, and if there is no room
+    // there, the least recently used protected entries are going back to probation
+    auto promote(list_type::iterator at) -> void
+    {
+        if (at->hot) {
+            protect.splice(protect.begin(), protect, at);
+            return;
+        }
+        protect.splice(protect.begin(), probation, at);
+        at->hot = true;
+        hot_bytes += at->bytes;
+        while (hot_bytes > hot_budget && protect.size() > 1) {
+            const auto last = std::prev(protect.end());
+            last->hot = false;
+            hot_bytes -= last->bytes;
+            probation.splice(probation.begin(), protect, last);
+        }
+    }
+
+    // the entries that we would drop next to free at least the given number of bytes, and the
+    // highest frequency among them
+    auto victims(std::size_t need) -> std::pair<std::vector<list_type::iterator>, std::uint8_t>
+    {
+        std::vector<list_type::iterator> out;
+        std::uint8_t highest = 0;
+        std::size_t freed = 0;
+        for (auto* segment : {&probation, &protect}) {
+            for (auto i = segment->rbegin(); i != segment->rend() && freed < need; ++i) {
+                out.push_back(std::prev(i.base()));
+                freed += i->bytes;
+                highest = std::max(highest, frequency(i->hash));
+            }
+        }
+        return {std::move(out), highest};
+    }
+
+    std::mutex lock;
+    list_type probation;                // most recently used is at the front
+    list_type protect;
+    std::unordered_map<std::string_view, list_type::iterator> index_of;    // the keys are pointing into the entries
+    std::vector<std::uint8_t> sketch;
+    std::size_t additions = 0;
+    std::size_t reset_at = 0;
+    std::size_t budget = 0;
+    std::size_t hot_budget = 0;
+    std::size_t bytes = 0;
+    std::size_t hot_bytes = 0;
+    stats counters;
+};
+
+lookup_cache::lookup_cache(options opts) : config{opts}
+{
+    config.shards = std::max<std::size_t>(config.shards, 1);
+    shards = std::make_unique<shard[]>(config.shards);
+    const auto width = round_up(config.max_entries / config.shards);
+    for (std::size_t i = 0; i < config.shards; ++i) {
+        auto& s = shards[i];
+        s.sketch.assign(width, 0);
+        s.reset_at = width * 10;
+        s.budget = config.max_bytes / config.shards;
+        s.hot_budget = s.budget * PROTECTED_PERCENT / 100;
+    }
+}
+
+lookup_cache::~lookup_cache() = default;
+
+auto lookup_cache::at(const std::string& key, std::size_t& hash) -> shard&
+{
+    hash = std::hash<std::string>{}(key);
+    // the low bits of the hash are used by the sketch, so the shard is taken from the high bits of a mix of it
+    const auto mixed = static_cast<std::uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+    return shards[static_cast<std::size_t>(mixed >> 40) % config.shards];
+}
+
+auto lookup_cache::find(const std::string& key) -> std::optional<value_type>
+{
+    std::size_t hash = 0;
+    auto& s = at(key, hash);
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.touch(hash);
+    const auto found = s.index_of.find(key);
+    if (found == s.index_of.end()) {
+        ++s.counters.misses;
+        return {};
+    }
+    const auto e = found->second;
+    if (clock_type::now() >= e->expires) {
+        s.remove(e);
+        ++s.counters.expirations;
+        ++s.counters.misses;
+        return {};
+    }
+    ++s.counters.hits;
+    s.promote(e);
+    return e->value;
+}
+
+auto lookup_cache::store(const std::string& key, value_type value) -> void
+{
+    std::size_t hash = 0;
+    auto& s = at(key, hash);
+    const auto bytes = ENTRY_OVERHEAD + key.size() * 2 + (value ? value->size() : 0);
+    const auto expires = clock_type::now() + config.ttl;
+    std::lock_guard<std::mutex> guard(s.lock);
+    if (const auto found = s.index_of.find(key); found != s.index_of.end()) {
+        s.remove(found->second);
+    }
+    if (bytes > s.budget) {
+        return;
+    }
+    if (s.bytes + bytes > s.budget) {
+        // only keep the new entry if it is read more often than all the ones that it replaces,
+        // otherwise we keep the cache as it is
+        auto [drop, highest] = s.victims(s.bytes + bytes - s.budget);
+        if (s.frequency(hash) <= highest) {
+            ++s.counters.rejections;
+            return;
+        }
+        for (auto v : drop) {
+            s.remove(v);
+        }
+        s.counters.evictions += drop.size();
+    }
+    s.probation.push_front(shard::entry{key, std::move(value), hash, bytes, expires, false});
+    const auto added = s.probation.begin();
+    s.index_of.emplace(added->key, added);
+    s.bytes += bytes;
+}
+
+auto lookup_cache::invalidate(const std::string& key) -> void
+{
+    std::size_t hash = 0;
+    auto& s = at(key, hash);
+    std::lock_guard<std::mutex> guard(s.lock);
+    if (const auto found = s.index_of.find(key); found != s.index_of.end()) {
+        s.remove(found->second);
+    }
+}
+
+auto lookup_cache::clear() -> void
+{
+    for (std::size_t i = 0; i < config.shards; ++i) {
+        auto& s = shards[i];
+        std::lock_guard<std::mutex> guard(s.lock);
+        s.index_of.clear();
+        s.probation.clear();
+        s.protect.clear();
+        s.bytes = s.hot_bytes = 0;
+    }
+}
+
+auto lookup_cache::statistics() const -> stats
+{
+    stats out;
+    for (std::size_t i = 0; i < config.shards; ++i) {
+        auto& s = shards[i];
+        std::lock_guard<std::mutex> guard(s.lock);
+        out.hits += s.counters.hits;
+        out.misses += s.counters.misses;
+        out.evictions += s.counters.evictions;
+        out.rejections += s.counters.rejections;
+        out.expirations += s.counters.expirations;
+        out.entries += s.index_of.size();
+        out.bytes += s.bytes;
+    }
+    return out;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+cached_rmap::cached_rmap(end_point ep, lookup_cache::options opts) :
+    cached_rmap(std::move(ep), std::make_shared<lookup_cache>(opts))
+{
+}
+
+cached_rmap::cached_rmap(end_point ep, std::shared_ptr<lookup_cache> shared) :
+    map{std::move(ep)}, entries{std::move(shared)}
+{
+    if (!entries) {
+        throw std::invalid_argument("cached map must have a cache");
+    }
+}
+
+cached_rmap::mapped_type cached_rmap::find(const key_type& key) const
+{
+    const auto k = string_key(key);
+    if (auto v = entries->find(k); v) {
+        return v->value_or(mapped_type{});
+    }
+    auto value = map.find(key);
+    entries->store(k, value);
+    return value;
+}
+
+bool cached_rmap::insert(const key_type& key, const mapped_type& value) const
+{
+    const auto k = string_key(key);
+    try {
+        if (map.insert(key, value)) {
+            entries->store(k, value);
+            return true;
+        }
+    } catch (...) {
+        entries->invalidate(k);     // we don't know if it was changed
+        throw;
+    }
+    entries->invalidate(k);
+    return false;
+}
+
+void cached_rmap::erase(const key_type& key) const
+{
+    entries->invalidate(string_key(key));
+    map.erase(key);
+}
+
+void cached_rmap::invalidate(const key_type& key) const
+{
+    entries->invalidate(string_key(key));
+}
+
+lookup_cache& cached_rmap::cache() const
+{
+    return *entries;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+cached_rmultimap::cached_rmultimap(end_point ep, lookup_cache::options opts) :
+    cached_rmultimap(std::move(ep), std::make_shared<lookup_cache>(opts))
+{
+}
+
+cached_rmultimap::cached_rmultimap(end_point ep, std::shared_ptr<lookup_cache> shared) :
+    map{std::move(ep)}, entries{std::move(shared)}
+{
+    if (!entries) {
+        throw std::invalid_argument("cached map must have a cache");
+    }
+}
+
+std::optional<cached_rmultimap::mapped_type> cached_rmultimap::find(const key_type& key, const key_type& field) const
+{
+    const auto k = field_key(key, field);
+    if (auto v = entries->find(k); v) {
+        return *v;
+    }
+    auto value = map[key].find(field);
+    entries->store(k, value);
+    return value;
+}
+
+bool cached_rmultimap::insert(const key_type& key, const key_type& field, const mapped_type& value) const
+{
+    const auto k = field_key(key, field);
+    try {
+        if (map[key].insert(field, value)) {
+            entries->store(k, value);
+            return true;
+        }
+    } catch (...) {
+        entries->invalidate(k);
+        throw;
+    }
+    entries->invalidate(k);
+    return false;
+}
+
+void cached_rmultimap::erase(const key_type& key, const key_type& field) const
+{
+    entries->invalidate(field_key(key, field));
+    map[key].erase(field);
+}
+
+void cached_rmultimap::invalidate(const key_type& key, const key_type& field) const
+{
+    entries->invalidate(field_key(key, field));
+}
+
+lookup_cache& cached_rmultimap::cache() const
+{
+    return *entries;
+}
+
+}   // end of namespace redis
+
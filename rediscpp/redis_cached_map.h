@@ -0,0 +1,153 @@
+#pragma once
+
+#include "redis_messages.h"
+#include "redis_multimap.h"
+#include <string>
+#include <optional>
+#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * the near cache (redis_near_cache.h) relies on the server telling us which keys were changed,
+ * this needs redis 6 with RESP3, and a connection that we can read notifications from. When this
+ * is not possible (older servers, proxies in the middle), we can still keep the values that we
+ * read for a short time - every entry is only used up to its TTL, so the staleness is bounded.
+ * The lookup cache has a fixed memory budget, and it decides what to keep with TinyLFU - a small
+ * sketch counts how often each key is read, and a new key only replaces an old one if it is read
+ * more often, so a scan over many keys would not flush the keys that are hot. The entries that
+ * we keep are in segmented LRU - a probation segment for new entries, and a protected one for
+ * entries that were read again.
+ * The cache is split into shards, each with its own lock, so it can be shared by many threads,
+ * each with its own connection (see connection_pool).
+ * Writes that are done through the cached map are updating the cache, writes by others are only
+ * seen after the TTL.
+ **/
+
+namespace redis
+{
+    /* usage:
+        lookup_cache::options opts;
+        opts.max_bytes = 32 * 1024 * 1024;
+        opts.ttl = std::chrono::milliseconds{500};
+        auto shared = std::make_shared<lookup_cache>(opts);
+        // in each thread
+        auto lease = pool.checkout();
+        cached_rmap users(lease.get(), shared);
+        auto name = users.find("user:1:name");    // from the server
+        name = users.find("user:1:name");         // from the cache, for up to 500ms
+        cached_rmultimap profiles(lease.get(), shared);
+        auto city = profiles.find("user:1", "city");
+        std::cout<<"hit ratio "<<shared->statistics().hit_ratio()<<std::endl;
+    */
+    struct lookup_cache
+    {
+        using milliseconds_t = end_point::milliseconds_t;
+        using value_type = std::optional<std::string>;     // empty for keys that don't exist
+
+        struct options
+        {
+            std::size_t max_bytes = 64 * 1024 * 1024;   // approximate size of memory that we are using
+            std::size_t max_entries = 100'000;          // the size of the frequency sketch is based on this
+            milliseconds_t ttl = std::chrono::seconds{1};   // the longest time that we are using an entry
+            std::size_t shards = 16;                    // more shards - less contention between threads
+        };
+
+        struct stats
+        {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t evictions = 0;    // entries that were dropped to make room for new ones
+            std::uint64_t rejections = 0;   // new entries that were not kept since they were read less than the old ones
+            std::uint64_t expirations = 0;  // entries that were dropped since their TTL passed
+            std::size_t entries = 0;
+            std::size_t bytes = 0;
+
+            auto hit_ratio() const -> double {
+                const auto total = hits + misses;
+                return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+            }
+        };
+
+        explicit lookup_cache(options opts);
+
+        ~lookup_cache();
+
+        lookup_cache(const lookup_cache&) = delete;
+        lookup_cache& operator = (const lookup_cache&) = delete;
+
+        // all of these can be called from any thread
+        auto find(const std::string& key) -> std::optional<value_type>;
+
+        auto store(const std::string& key, value_type value) -> void;
+
+        auto invalidate(const std::string& key) -> void;
+
+        auto clear() -> void;
+
+        auto statistics() const -> stats;
+
+    private:
+        struct shard;
+
+        auto at(const std::string& key, std::size_t& hash) -> shard&;
+
+        options config;
+        std::unique_ptr<shard[]> shards;
+    };
+
+    struct cached_rmap
+    {
+        using key_type = rmap::key_type;
+        using mapped_type = rmap::mapped_type;
+
+        cached_rmap(end_point ep, lookup_cache::options opts);
+
+        // share the cache with other maps (for example, one for each thread)
+        cached_rmap(end_point ep, std::shared_ptr<lookup_cache> shared);
+
+        // same as rmap::find, from the cache if we have it
+        mapped_type find(const key_type& key) const;
+
+        // these are sent to the server, and update the cache
+        bool insert(const key_type& key, const mapped_type& value) const;
+
+        void erase(const key_type& key) const;
+
+        // drop the key from the cache, for when we know it was changed
+        void invalidate(const key_type& key) const;
+
+        lookup_cache& cache() const;
+
+    private:
+        rmap map;
+        std::shared_ptr<lookup_cache> entries;
+    };
+
+    struct cached_rmultimap
+    {
+        using key_type = rmmap_proxy::key_type;
+        using mapped_type = rmmap_proxy::mapped_type;
+
+        cached_rmultimap(end_point ep, lookup_cache::options opts);
+
+        cached_rmultimap(end_point ep, std::shared_ptr<lookup_cache> shared);
+
+        // same as rmultimap[key].find(field), from the cache if we have it
+        std::optional<mapped_type> find(const key_type& key, const key_type& field) const;
+
+        bool insert(const key_type& key, const key_type& field, const mapped_type& value) const;
+
+        void erase(const key_type& key, const key_type& field) const;
+
+        void invalidate(const key_type& key, const key_type& field) const;
+
+        lookup_cache& cache() const;
+
+    private:
+        mutable rmultimap map;
+        std::shared_ptr<lookup_cache> entries;
+    };
+}   // end of namespace redis
+
@@ -1,28 +1,27 @@
 #include "redis_channel.h"
 #include "redis_reply.h"
-#include <hiredis/hiredis.h>
-#include <errno.h>
+#include "redis_pipeline.h"
+#include "rediscpp/internal/commands.h"
+#include "rediscpp/internal/wakeup.h"
+#include "rediscpp/internal/pubsub.h"
 
 namespace redis
 {
-    namespace
-    {
-        const std::string TERMINATION_MESSAGE = std::string("TErMinate++&%$$@@^jjk&5");  // some random string..
-    }   // end of local message
 
 
     channel::channel()
     {
     }
 
-    channel::channel(const std::string& n, end_point srv) : server(srv), topic(n)
+    channel::channel(const std::string& n, end_point srv, mode_t m) : server(srv), topic(n), mode(m)
     {
     }
 
-    bool channel::create(const std::string& n, end_point srv)
+    bool channel::create(const std::string& n, end_point srv, mode_t m)
     {
         server = srv;
         topic = n;
+        mode = m;
         return true;
     }
 
@@ -32,6 +31,11 @@ namespace redis
         return topic.c_str();
     }
 
+    bool channel::sharded() const
+    {
+        return mode == SHARDED;
+    }
+
     end_point& channel::by() const
     {
         return server;
@@ -84,21 +88,47 @@ namespace redis
     void publisher::send(const std::string& msg) const
     {
         if (comm.by()) {
-            redisCommand(cast(comm.by()), "PUBLISH %s %b", comm.name(), msg.data(), msg.size());
+            internal::process<void>::run(comm.by(), internal::pubsub::publish_command(comm.sharded()), comm.name(), msg);
         } else {
             throw connection_error("trying to send with invalid redis endpoint object");
         }
 
     }
 
+    std::vector<std::int64_t> publisher::send_batch(const std::string_view* messages, std::size_t count) const
+    {
+        if (!comm.by()) {
+            throw connection_error("trying to send with invalid redis endpoint object");
+        }
+        pipeline batch(comm.by());
+        std::vector<deferred<result::integer>> replies;
+        replies.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            replies.push_back(internal::queue<result::integer>(batch, internal::pubsub::publish_command(comm.sharded()), comm.name(), messages[i]));
+        }
+        if (const auto e = Error(batch.exec()); e) {
+            throw connection_error(std::string("failed to publish to ") + comm.name() + ": " + e.value());
+        }
+        std::vector<std::int64_t> delivered;
+        delivered.reserve(count);
+        for (const auto& r : replies) {
+            delivered.push_back(r.value().message());
+        }
+        return delivered;
+    }
+
     ///////////////////////////////////////////////////////////////////////////
     //
-    subscriber::subscriber(const channel& c) : comm(c), done(false)
+    subscriber::subscriber(const channel& c) : comm(c), done(false), wake(std::make_shared<internal::wakeup>())
     {
         if (!comm.by()) {
             throw connection_error("trying to create subscriber with invalid redis endpoint object");
         }
-        redisCommand(cast(comm.by()), "SUBSCRIBE %s", comm.name());
+        if (buffers(comm.by()).route) {
+            // the messages would arrive on the connections that the router is using, not on this one
+            throw connection_error("cannot subscribe over cluster or replicated end point, use direct connection to the node");
+        }
+        internal::process<void>::run(comm.by(), internal::pubsub::subscribe_command(comm.sharded()), comm.name());
     }
 
     subscriber::~subscriber()
@@ -129,86 +159,122 @@ namespace redis
         if (!comm.by()) {
             throw connection_error("trying to close subscriber with invalid redis endpoint object");
         }
-        redisCommand(cast(comm.by()), "UNSUBSCRIBE %s", comm.name());
+        if (done) {
+            return;
+        }
+        // we are not waiting for the reply, we are not going to read from this anymore
+        auto& request = buffers(comm.by()).out;
+        request.clear();
+        request.command(internal::pubsub::unsubscribe_command(comm.sharded()), comm.name());
+        internal::resp::send(comm.by(), request.data());
         done = true;
     }
 
     subscriber::message_type subscriber::read() const
+    {
+        return copy(read_for(end_point::milliseconds_t(-1)));
+    }
+
+    subscriber::message_view subscriber::read_view() const
+    {
+        return read_for(end_point::milliseconds_t(-1));
+    }
+
+    subscriber::message_view subscriber::read_view(const end_point::milliseconds_t& ms) const
+    {
+        return read_for(ms);
+    }
+
+    subscriber::state subscriber::read_into(std::string& payload) const
+    {
+        return read_into(payload, end_point::milliseconds_t(-1));
+    }
+
+    subscriber::state subscriber::read_into(std::string& payload, const end_point::milliseconds_t& ms) const
+    {
+        const message_view m = read_for(ms);
+        payload.assign(m.first.data(), m.first.size());
+        return m.second;
+    }
+
+    subscriber::message_type subscriber::copy(const message_view& from)
+    {
+        return message_type(std::string(from.first), from.second);
+    }
+
+    subscriber::message_view subscriber::read_for(const end_point::milliseconds_t& timeout) const
     {
 #if defined(ERROR)
 #   undef ERROR
 #endif
-        static const message_type error = message_type(std::string(), ERROR);
-        static const message_type timeout_t = message_type(std::string(), TIME_OUT);
-        static const message_type finish = message_type(std::string(), DONE);
+        using clock_type = std::chrono::steady_clock;
 
-        if (!comm.by()) {
-            throw connection_error("trying to close subscriber with invalid redis endpoint object");
-        }
+        static const message_view error = message_view(std::string_view(), ERROR);
+        static const message_view expired = message_view(std::string_view(), TIME_OUT);
+        static const message_view finish = message_view(std::string_view(), DONE);
 
-        if (done) {
-            return finish;
+        if (!comm.by()) {
+            throw connection_error("trying to read from subscriber with invalid redis endpoint object");
         }
-        //reply red;
-
-        redisReply* r = nullptr;//cast(red);
+        // we are done with the last message, so the reader can reuse its memory
+        current = result::any();
 
-        if (redisGetReply(cast(comm.by()), (void**)&r) == REDIS_OK) {
-            if (r->element && r->element[2]) {
-
-                auto msg = std::string(r->element[2]->str, r->element[2]->len); 
-                if (msg == TERMINATION_MESSAGE || msg.empty()) {
-#if defined (WIN32) && defined(close)
-#   pragma push_macro("close")
-#   undef close
-#   define IGNORE_DEFINE_FOR_CLOSE_GLOBAL_LEVEL_WAS_PUSHED
-#endif  // WIN32 && close
-                    close();
-#if defined (IGNORE_DEFINE_FOR_CLOSE_GLOBAL_LEVEL_WAS_PUSHED)
-#   pragma pop_macro("close")
-#   undef IGNORE_DEFINE_FOR_CLOSE_GLOBAL_LEVEL_WAS_PUSHED
-#endif  //IGNORE_DEFINE_FOR_CLOSE_GLOBAL_LEVEL_WAS_PUSHED
-                    return finish;
-                } else {
-                    return message_type(msg, OK);
+        const auto deadline = clock_type::now() + timeout;
+        auto& in = buffers(comm.by()).in;
+        while (!done) {
+            const auto r = in.next();
+            if (r.is_error()) {
+                return error;
+            }
+            if (const auto& reply = r.unwrap(); reply) {
+                const auto e = internal::pubsub::classify(*reply, comm.sharded());
+                if (e.kind == internal::pubsub::event::MESSAGE) {
+                    current = *reply;   // this is what keeps the payload alive
+                    return message_view(e.payload, OK);
                 }
-            } else {
-                int e = errno;
-                if (e == EAGAIN) {
-                    return timeout_t;
-                } else {
+                if (e.kind == internal::pubsub::event::UNSUBSCRIBED) {
+                    // we didn't ask for it, so the slot of this sharded channel moved to another node
+                    done = true;
+                    return error;
+                }
+                continue;       // confirmation that we can skip
+            }
+            auto wait = end_point::milliseconds_t(-1);
+            if (timeout.count() >= 0) {
+                wait = std::chrono::duration_cast<end_point::milliseconds_t>(deadline - clock_type::now());
+                if (wait.count() < 0) {
+                    return expired;
+                }
+            }
+            const auto f = internal::resp::fill(comm.by(), wait, wake->handle());
+            if (f.is_error()) {
+                return error;
+            }
+            if (wake->consume()) {
 #if defined (WIN32) && defined(close)
 #   pragma push_macro("close")
 #   undef close
 #   define IGNORE_DEFINE_FOR_CLOSE_GLOBAL_LEVEL_WAS_PUSHED
 #endif  // WIN32 && close
-                    close();
+                close();
 #if defined (IGNORE_DEFINE_FOR_CLOSE_GLOBAL_LEVEL_WAS_PUSHED)
 #   pragma pop_macro("close")
 #   undef IGNORE_DEFINE_FOR_CLOSE_GLOBAL_LEVEL_WAS_PUSHED
-#endif  // IGNORE_DEFINE_FOR_CLOSE_GLOBAL_LEVEL_WAS_PUSHED
-                    return finish;
-                }
+#endif  //IGNORE_DEFINE_FOR_CLOSE_GLOBAL_LEVEL_WAS_PUSHED
+                return finish;
             }
-        } else {
-            int e = errno;
-            if (e == EAGAIN) {
-                return timeout_t;
-            } else {
-                return error;
+            if (!f.unwrap() && timeout.count() >= 0 && clock_type::now() >= deadline) {
+                return expired;
             }
         }
-	// should not get here
-	return error;
+        return finish;
     }
 
     subscriber::message_type subscriber::read(const end_point::timeout_t& to) const
     {
-        static const end_point::timeout_t no_timeout_t = end_point::timeout_t(end_point::seconds_t(0), end_point::milliseconds_t(0));
-        comm.by().set_timeout(to);
-        message_type m = read();
-        comm.by().set_timeout(no_timeout_t);
-        return m;
+        const auto ms = std::chrono::duration_cast<end_point::milliseconds_t>(to.sec()) + to.milliseconds();
+        // as with the socket timeout, zero means that there is no timeout
+        return ms.count() == 0 ? read() : copy(read_for(ms));
     }
 
     subscriber::message_type subscriber::read(const end_point::seconds_t& s) const
@@ -223,9 +289,7 @@ namespace redis
 
     void subscriber::interrupt() const
     {
-        publisher p = comm.make_publisher();
-        comm.by().set_timeout(end_point::timeout_t(end_point::seconds_t(1), end_point::milliseconds_t(0)));
-        p.send(TERMINATION_MESSAGE); 
+        wake->notify();
     }
 }   // end of namespace redis
 
@@ -1,8 +1,14 @@
 #pragma once
 
 #include "redis_endpoint.h"
+#include "redis_reply.h"
 #include <string>
 #include <utility>
+#include <memory>
+#include <vector>
+#include <string_view>
+#include <iterator>
+#include <cstdint>
 
 namespace redis
 {
@@ -12,6 +18,8 @@ namespace redis
         // in one thread or process do ..
         publisher sender = messages.make_publisher();
         sender.send("a message");
+        // or send many messages in one write, and get the number of subscribers that got each one
+        std::vector<std::int64_t> delivered = sender.send_batch(std::vector<std::string>{"first", "second"});
         // in another thread or process do 
         subscriber reader messages.make_subscriber();
         // do wait for more than 10 seconds_t
@@ -21,20 +29,37 @@ namespace redis
         } else {
             std::cout<<"fail to get a message from the publisher in 10 seconds_t"<<std::endl;
         }
+        // without copying the message (valid until the next read)
+        subscriber::message_view view = reader.read_view(end_point::milliseconds_t(100));
    */
     struct publisher;
     struct subscriber;
 
+    namespace internal
+    {
+        struct wakeup;
+    }   // end of namespace internal
+
     struct channel
     {
+        // with redis cluster, messages of classic channels are sent to all the nodes, while sharded
+        // channels (redis 7) are only sent to the node that owns the slot of the channel name.
+        // To read from sharded channels on a cluster, use sharded_subscriber (redis_sharded_subscriber.h)
+        enum mode_t {
+            CLASSIC,
+            SHARDED
+        };
+
         channel();  // default ctor dose nothing
 
-        channel(const std::string& n, end_point srv);
+        channel(const std::string& n, end_point srv, mode_t m = CLASSIC);
 
-        bool create(const std::string& n, end_point srv);
+        bool create(const std::string& n, end_point srv, mode_t m = CLASSIC);
 
         const char* name() const;
 
+        bool sharded() const;
+
         end_point& by() const;
 
         publisher make_publisher() const;
@@ -46,6 +71,7 @@ namespace redis
     private:
         mutable end_point server;
         std::string topic;
+        mode_t mode = CLASSIC;
     };
 
     struct publisher
@@ -59,6 +85,26 @@ namespace redis
 
         void send(const std::string& msg) const;
 
+        // all the messages are sent in one write (pipelined), and we only wait once for
+        // all the replies. Return for each message the number of subscribers that received it
+        std::vector<std::int64_t> send_batch(const std::string_view* messages, std::size_t count) const;
+
+        template<typename It>
+        std::vector<std::int64_t> send_batch(It first, It last) const
+        {
+            std::vector<std::string_view> messages;
+            for (; first != last; ++first) {
+                messages.emplace_back(*first);
+            }
+            return send_batch(messages.data(), messages.size());
+        }
+
+        template<typename Range>
+        std::vector<std::int64_t> send_batch(const Range& messages) const
+        {
+            return send_batch(std::begin(messages), std::end(messages));
+        }
+
     private:
         channel comm;
     };
@@ -82,6 +128,8 @@ namespace redis
 #   undef HAS_ERROR_MACRO_THAT_WAS_MASKED_SO_IGNORE
 #endif // HAS_ERROR_MACRO_THAT_WAS_MASKED_SO_IGNORE
         typedef std::pair<std::string, state> message_type;
+        // the payload is pointing to the memory of the message we read, and it is only valid until the next read
+        typedef std::pair<std::string_view, state> message_view;
 
     private:
         subscriber(const channel& c);
@@ -91,20 +139,40 @@ namespace redis
 
         message_type read() const;
 
+        // zero timeout means wait with no timeout, same as read() above
         message_type read(const end_point::timeout_t& to) const;
 
         message_type read(const end_point::seconds_t& s) const;
 
         message_type read(const end_point::milliseconds_t& ms) const;
+
+        // same as read, but without copying the payload - see message_view. Unlike read,
+        // zero timeout here means don't wait, and negative means no timeout
+        message_view read_view() const;
+
+        message_view read_view(const end_point::milliseconds_t& ms) const;
+
+        // copy the payload into the given string, reusing its memory
+        state read_into(std::string& payload) const;
+
+        state read_into(std::string& payload, const end_point::milliseconds_t& ms) const;
+
         // would only work if this is running in different thread to finish this - once this is called
         // you would not be able to read from this channel any more!
+        // This is only waking up the reading thread, nothing is sent to the server
         void interrupt() const;   
 
         void close() const;
     private:
+        // negative timeout means wait until we have a message
+        message_view read_for(const end_point::milliseconds_t& timeout) const;
+
+        static message_type copy(const message_view& from);
 
         mutable channel comm;
         mutable bool    done;
+        mutable result::any current;    // the last message that we read, the payload of read_view points into it
+        std::shared_ptr<internal::wakeup> wake;
     };
 }
 
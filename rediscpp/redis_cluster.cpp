@@ -0,0 +1,498 @@
+#include "redis_cluster.h"
+#include "rediscpp/internal/commands.h"
+#include "rediscpp/internal/router.h"
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <chrono>
+#include <charconv>
+
+namespace redis
+{
+
+using namespace std::string_literals;
+
+namespace
+{
+    constexpr int MAX_REDIRECTS = 5;
+    constexpr std::string_view ASKING = "*1\r\n$6\r\nASKING\r\n";
+
+    // CRC16 XMODEM - this is what redis cluster is using for the key slots
+    constexpr auto crc16_table() -> std::array<std::uint16_t, 256> {
+        std::array<std::uint16_t, 256> table{};
+        for (std::uint16_t i = 0; i < 256; ++i) {
+            std::uint16_t crc = static_cast<std::uint16_t>(i << 8);
+            for (int b = 0; b < 8; ++b) {
+                crc = static_cast<std::uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    constexpr auto CRC16_TABLE = crc16_table();
+
+    auto crc16(std::string_view data) -> std::uint16_t {
+        std::uint16_t crc = 0;
+        for (const auto c : data) {
+            crc = static_cast<std::uint16_t>((crc << 8) ^ CRC16_TABLE[((crc >> 8) ^ static_cast<std::uint8_t>(c)) & 0xff]);
+        }
+        return crc;
+    }
+
+    // these commands don't have a key as the first argument, so it doesn't matter which server gets them
+    auto keyless(std::string_view command) -> bool {
+        static constexpr std::string_view commands[] = {
+            "AUTH", "CLIENT", "CLUSTER", "DBSIZE", "ECHO", "FLUSHALL", "FLUSHDB", "HELLO", "INFO",
+            "KEYS", "PING", "PUBLISH", "RANDOMKEY", "SCAN", "SELECT", "TIME"
+        };
+        return std::any_of(std::begin(commands), std::end(commands), [command](auto c) {
+            return boost::algorithm::iequals(c, command);
+        });
+    }
+
+    auto open(end_point& ep, const std::string& host, std::uint16_t port, const end_point::timeout_t& to) -> end_point::result_t {
+        if (to.sec().count() == 0 && to.milliseconds().count() == 0) {
+            return ep.open(host, port);
+        }
+        return ep.open(host, to, port);
+    }
+
+    auto message_of(const internal::router::reply_type& reply) -> std::string_view {
+        if (reply.is_error() || !reply.unwrap().is_error()) {
+            return {};
+        }
+        return result::try_into<result::error>(reply.unwrap()).unwrap().message();
+    }
+
+    // for "MOVED 3999 127.0.0.1:6381" return the slot and the address
+    auto parse_redirect(std::string_view message, std::uint16_t& slot, std::string& host, std::uint16_t& port) -> bool {
+        std::vector<std::string> parts;
+        boost::algorithm::split(parts, message, boost::is_any_of(" "), boost::token_compress_on);
+        if (parts.size() != 3) {
+            return false;
+        }
+        const auto colon = parts[2].rfind(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+        host = parts[2].substr(0, colon);
+        const auto& s = parts[1];
+        const auto& p = parts[2];
+        return std::from_chars(s.data(), s.data() + s.size(), slot).ec == std::errc{} &&
+            std::from_chars(p.data() + colon + 1, p.data() + p.size(), port).ec == std::errc{} && slot < cluster_end_point::SLOTS;
+    }
+
+    auto to_int(const result::any& a) -> std::int64_t {
+        const auto i = a.as_int();
+        return i.is_ok() ? i.unwrap().message() : -1;
+    }
+
+    auto to_str(const result::any& a) -> std::string {
+        const auto s = a.as_string();
+        if (s.is_ok()) {
+            return result::to_string(s.unwrap());
+        }
+        const auto st = a.as_status();
+        return st.is_ok() ? std::string(st.unwrap().message()) : std::string{};
+    }
+
+    // the maps in CLUSTER SHARDS reply are arrays of key and value
+    auto field(const result::array& map, std::string_view name) -> result::any {
+        for (std::size_t i = 0; i + 1 < map.size(); i += 2) {
+            if (to_str(map.view(i)) == name) {
+                return map.view(i + 1);
+            }
+        }
+        return {};
+    }
+
+    struct slot_range
+    {
+        std::int64_t from = 0;
+        std::int64_t to = 0;
+        std::string host;
+        std::uint16_t port = 0;
+    };
+}   // end of local namespace
+
+namespace details
+{
+    struct cluster_router : internal::router
+    {
+        struct node
+        {
+            std::string host;
+            std::uint16_t port = 0;
+            end_point connection;
+        };
+
+        explicit cluster_router(end_point::timeout_t to) : timeout{to}, slots(cluster_end_point::SLOTS, -1) {
+        }
+
+        auto execute(std::string_view requests, std::size_t count) -> replies_type override;
+
+        auto refresh() -> cluster_end_point::result_t;
+
+        auto index_of(const std::string& host, std::uint16_t port) -> std::size_t;
+
+        auto connect(std::size_t at) -> end_point*;
+
+        auto route(const internal::resp::request_view& request) const -> std::size_t;
+
+        // send a single command to the given node, and return its reply
+        auto single(std::size_t at, std::string_view raw, bool asking) -> reply_type;
+
+        // follow MOVED and ASK replies until we have the real reply
+        auto redirect(const internal::resp::request_view& request, reply_type& reply) -> void;
+
+        auto broken(std::size_t at) -> void;
+
+        auto load(const std::vector<slot_range>& ranges) -> void;
+
+        end_point::timeout_t timeout;
+        std::vector<node> nodes;
+        std::vector<std::int32_t> slots;        // the index of the node that owns each slot
+        std::vector<std::size_t> masters;       // the nodes that owns slots
+        bool stale = false;
+        std::string scratch;                    // reused to build the commands for each node
+    };
+
+    auto cluster_router::index_of(const std::string& host, std::uint16_t port) -> std::size_t
+    {
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i].port == port && nodes[i].host == host) {
+                return i;
+            }
+        }
+        nodes.push_back(node{host, port, {}});
+        return nodes.size() - 1;
+    }
+
+    auto cluster_router::connect(std::size_t at) -> end_point*
+    {
+        auto& n = nodes[at];
+        if (!n.connection && open(n.connection, n.host, n.port, timeout).is_error()) {
+            return nullptr;
+        }
+        return &n.connection;
+    }
+
+    auto cluster_router::broken(std::size_t at) -> void
+    {
+        nodes[at].connection.close_it();
+        stale = true;
+    }
+
+    auto cluster_router::route(const internal::resp::request_view& request) const -> std::size_t
+    {
+        if (!request.key.empty() && !keyless(request.name)) {
+            if (const auto owner = slots[cluster_end_point::slot(request.key)]; owner >= 0) {
+                return static_cast<std::size_t>(owner);
+            }
+        }
+        // either there is no key, or we don't know the owner - the server would redirect us
+        return masters.empty() ? 0 : masters.front();
+    }
+
+    auto cluster_router::single(std::size_t at, std::string_view raw, bool asking) -> reply_type
+    {
+        const auto ep = connect(at);
+        if (!ep) {
+            stale = true;
+            return failed("failed to connect to cluster node " + nodes[at].host + ":" + std::to_string(nodes[at].port));
+        }
+        if (asking) {
+            scratch.assign(ASKING);
+            scratch.append(raw);
+            raw = scratch;
+        }
+        if (const auto e = Error(internal::resp::send(*ep, raw)); e) {
+            broken(at);
+            return failed(e.value());
+        }
+        if (asking) {
+            if (const auto r = internal::resp::receive(*ep); r.is_error()) {
+                broken(at);
+                return r;
+            }
+        }
+        auto r = internal::resp::receive(*ep);
+        if (r.is_error()) {
+            broken(at);
+        }
+        return r;
+    }
+
+    auto cluster_router::redirect(const internal::resp::request_view& request, reply_type& reply) -> void
+    {
+        for (int attempt = 0; attempt < MAX_REDIRECTS; ++attempt) {
+            const auto message = message_of(reply);
+            std::uint16_t slot = 0;
+            std::uint16_t port = 0;
+            std::string host;
+            if (boost::algorithm::starts_with(message, "MOVED ") && parse_redirect(message, slot, host, port)) {
+                // the slot was moved for good, so the rest of our table may be wrong too
+                const auto at = index_of(host, port);
+                slots[slot] = static_cast<std::int32_t>(at);
+                stale = true;
+                reply = single(at, request.raw, false);
+            } else if (boost::algorithm::starts_with(message, "ASK ") && parse_redirect(message, slot, host, port)) {
+                // the slot is in the middle of migration, only this command goes to the other node
+                reply = single(index_of(host, port), request.raw, true);
+            } else if (boost::algorithm::starts_with(message, "TRYAGAIN") || boost::algorithm::starts_with(message, "CLUSTERDOWN")) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{50 * (attempt + 1)});
+                reply = single(route(request), request.raw, false);
+            } else {
+                return;
+            }
+        }
+    }
+
+    auto cluster_router::execute(std::string_view requests, std::size_t count) -> replies_type
+    {
+        replies_type replies(count, reply_type{failed("invalid command"s)});
+        std::vector<internal::resp::request_view> commands;
+        commands.reserve(count);
+        while (commands.size() < count) {
+            const auto r = internal::resp::next_request(requests);
+            if (!r) {
+                break;
+            }
+            commands.push_back(*r);
+        }
+        // split the commands between the nodes, keeping their order inside each node
+        std::vector<std::vector<std::size_t>> groups(nodes.size());
+        for (std::size_t i = 0; i < commands.size(); ++i) {
+            groups[route(commands[i])].push_back(i);
+        }
+        // first send to all of them, so that the servers are working at the same time
+        std::vector<bool> sent(groups.size(), false);
+        for (std::size_t n = 0; n < groups.size(); ++n) {
+            if (groups[n].empty()) {
+                continue;
+            }
+            const auto ep = connect(n);
+            if (!ep) {
+                stale = true;
+                for (const auto i : groups[n]) {
+                    replies[i] = failed("failed to connect to cluster node " + nodes[n].host + ":" + std::to_string(nodes[n].port));
+                }
+                continue;
+            }
+            std::string_view data = commands[groups[n].front()].raw;
+            if (groups[n].size() > 1) {
+                scratch.clear();
+                for (const auto i : groups[n]) {
+                    scratch.append(commands[i].raw);
+                }
+                data = scratch;
+            }
+            if (const auto e = Error(internal::resp::send(*ep, data)); e) {
+                broken(n);
+                for (const auto i : groups[n]) {
+                    replies[i] = failed(e.value());
+                }
+                continue;
+            }
+            sent[n] = true;
+        }
+        for (std::size_t n = 0; n < groups.size(); ++n) {
+            if (!sent[n]) {
+                continue;
+            }
+            for (std::size_t g = 0; g < groups[n].size(); ++g) {
+                auto r = internal::resp::receive(nodes[n].connection);
+                if (r.is_error()) {
+                    broken(n);
+                    for (; g < groups[n].size(); ++g) {
+                        replies[groups[n][g]] = failed(r.error_value());
+                    }
+                    break;
+                }
+                replies[groups[n][g]] = std::move(r);
+            }
+        }
+        for (std::size_t i = 0; i < commands.size(); ++i) {
+            redirect(commands[i], replies[i]);
+        }
+        if (stale) {
+            refresh();
+        }
+        return replies;
+    }
+
+    auto cluster_router::load(const std::vector<slot_range>& ranges) -> void
+    {
+        std::fill(slots.begin(), slots.end(), -1);
+        masters.clear();
+        for (const auto& r : ranges) {
+            const auto at = index_of(r.host, r.port);
+            if (std::find(masters.begin(), masters.end(), at) == masters.end()) {
+                masters.push_back(at);
+            }
+            for (auto s = std::max<std::int64_t>(r.from, 0); s <= r.to && s < cluster_end_point::SLOTS; ++s) {
+                slots[static_cast<std::size_t>(s)] = static_cast<std::int32_t>(at);
+            }
+        }
+        stale = false;
+    }
+
+    auto cluster_router::refresh() -> cluster_end_point::result_t
+    {
+        // ask the nodes that own slots first, they are the most likely to be up
+        std::vector<std::size_t> order = masters;
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            if (std::find(order.begin(), order.end(), i) == order.end()) {
+                order.push_back(i);
+            }
+        }
+        std::string last_error = "no cluster node to ask for the slots"s;
+        for (const auto n : order) {
+            const auto ep = connect(n);
+            if (!ep) {
+                last_error = "failed to connect to " + nodes[n].host + ":" + std::to_string(nodes[n].port);
+                continue;
+            }
+            std::vector<slot_range> ranges;
+            // [[from, to, [host, port, id], replicas..], ..]
+            if (const auto r = internal::process<result::array>::run(*ep, "CLUSTER", "SLOTS"); r.is_ok()) {
+                const auto& all = r.unwrap();
+                for (std::size_t i = 0; i < all.size(); ++i) {
+                    const auto entry = all.view(i).as_array();
+                    if (entry.is_error() || entry.unwrap().size() < 3) {
+                        continue;
+                    }
+                    const auto& e = entry.unwrap();
+                    const auto master = e.view(2).as_array();
+                    if (master.is_error() || master.unwrap().size() < 2) {
+                        continue;
+                    }
+                    auto host = to_str(master.unwrap().view(0));
+                    ranges.push_back(slot_range{to_int(e.view(0)), to_int(e.view(1)),
+                        host.empty() || host == "?" ? nodes[n].host : host,
+                        static_cast<std::uint16_t>(to_int(master.unwrap().view(1)))
+                    });
+                }
+            } else if (const auto s = internal::process<result::array>::run(*ep, "CLUSTER", "SHARDS"); s.is_ok()) {
+                // [{slots: [from, to, ..], nodes: [{ip, endpoint, port, role ..}, ..]}, ..]
+                const auto& all = s.unwrap();
+                for (std::size_t i = 0; i < all.size(); ++i) {
+                    const auto shard = all.view(i).as_array();
+                    if (shard.is_error()) {
+                        continue;
+                    }
+                    const auto shard_slots = field(shard.unwrap(), "slots").as_array();
+                    const auto shard_nodes = field(shard.unwrap(), "nodes").as_array();
+                    if (shard_slots.is_error() || shard_nodes.is_error()) {
+                        continue;
+                    }
+                    for (std::size_t j = 0; j < shard_nodes.unwrap().size(); ++j) {
+                        const auto info = shard_nodes.unwrap().view(j).as_array();
+                        if (info.is_error() || to_str(field(info.unwrap(), "role")) != "master") {
+                            continue;
+                        }
+                        auto host = to_str(field(info.unwrap(), "endpoint"));
+                        if (host.empty() || host == "?") {
+                            host = to_str(field(info.unwrap(), "ip"));
+                        }
+                        const auto port = static_cast<std::uint16_t>(to_int(field(info.unwrap(), "port")));
+                        const auto& sl = shard_slots.unwrap();
+                        for (std::size_t k = 0; k + 1 < sl.size(); k += 2) {
+                            ranges.push_back(slot_range{to_int(sl.view(k)), to_int(sl.view(k + 1)),
+                                host.empty() ? nodes[n].host : host, port
+                            });
+                        }
+                    }
+                }
+            } else {
+                last_error = "failed to read cluster slots: " + s.error_value();
+                continue;
+            }
+            if (ranges.empty()) {
+                last_error = "the cluster has no slots assigned"s;
+                continue;
+            }
+            load(ranges);
+            return ok(true);
+        }
+        return failed(last_error);
+    }
+}   // end of namespace details
+
+cluster_end_point::cluster_end_point(std::vector<node_t> seeds, end_point::timeout_t to) :
+    router{std::make_shared<details::cluster_router>(to)}
+{
+    if (seeds.empty()) {
+        throw connection_error("no cluster nodes were given");
+    }
+    for (const auto& s : seeds) {
+        router->index_of(s.host, s.port);
+    }
+    // the first seed that we can connect to is used by the router, and the front is sharing its connection
+    end_point* seed = nullptr;
+    for (std::size_t i = 0; i < seeds.size() && !seed; ++i) {
+        seed = router->connect(router->index_of(seeds[i].host, seeds[i].port));
+    }
+    if (!seed) {
+        throw connection_error("failed to connect to any of the cluster nodes");
+    }
+    front = routed(*seed, router);
+    if (const auto e = Error(refresh()); e) {
+        throw connection_error(e.value());
+    }
+}
+
+cluster_end_point::cluster_end_point(const std::string& host, std::uint16_t port) :
+    cluster_end_point(std::vector<node_t>{node_t{host, port}})
+{
+}
+
+auto cluster_end_point::get() -> end_point&
+{
+    return front;
+}
+
+auto cluster_end_point::refresh() -> result_t
+{
+    return router->refresh();
+}
+
+auto cluster_end_point::nodes() const -> std::vector<node_t>
+{
+    std::vector<node_t> out;
+    for (const auto m : router->masters) {
+        out.push_back(node_t{router->nodes[m].host, router->nodes[m].port});
+    }
+    return out;
+}
+
+auto cluster_end_point::node_for(std::string_view key) const -> node_t
+{
+    const auto owner = router->slots[slot(key)];
+    if (owner < 0) {
+        return {};
+    }
+    const auto& n = router->nodes[static_cast<std::size_t>(owner)];
+    return node_t{n.host, n.port};
+}
+
+auto cluster_end_point::connect(const node_t& node, end_point& to) const -> end_point::result_t
+{
+    return open(to, node.host, node.port, router->timeout);
+}
+
+auto cluster_end_point::slot(std::string_view key) -> std::uint16_t
+{
+    // if there is a non empty {..} in the key, only this part is hashed
+    if (const auto open = key.find('{'); open != std::string_view::npos) {
+        if (const auto close = key.find('}', open + 1); close != std::string_view::npos && close > open + 1) {
+            key = key.substr(open + 1, close - open - 1);
+        }
+    }
+    return static_cast<std::uint16_t>(crc16(key) & (SLOTS - 1));
+}
+
+}   // end of namespace redis
+
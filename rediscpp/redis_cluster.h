@@ -0,0 +1,82 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include "result/results.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+/**
+ * redis cluster is splitting the keys between a number of servers - each key belongs to
+ * one of 16384 hash slots (CRC16 of the key), and each server owns a range of slots.
+ * The cluster end point is the front for all the servers in the cluster - it learns which server
+ * owns each slot (CLUSTER SLOTS or CLUSTER SHARDS) and sends each command to the right server.
+ * When the cluster changes, the servers are replying with MOVED or ASK, and we are following
+ * these redirects, and updating the slot table.
+ * Keys that has a hash tag - part of the key inside {}, are only hashed by this part, so
+ * keys with the same hash tag are always on the same server.
+ * see https://redis.io/docs/reference/cluster-spec/
+ **/
+
+namespace redis
+{
+    /* usage:
+        cluster_end_point cluster({{"127.0.0.1", 7000}, {"127.0.0.1", 7001}});
+        rmap map(cluster.get());
+        map.insert("foo", "bar");   // this is sent to the server that owns the slot of "foo"
+        long_int visits(cluster.get(), "{user:1}:visits");
+        rstring name(cluster.get(), "{user:1}:name");   // on the same server as the visits
+        pipeline batch(cluster.get());
+        // .. queue commands, on exec they are sent in one write to each of the servers
+        batch.exec();
+        // note that commands without key (for example rmap::size) are sent to one of the servers
+    */
+    namespace details
+    {
+        struct cluster_router;
+    }   // end of namespace details
+
+    struct cluster_end_point
+    {
+        static constexpr std::uint16_t SLOTS = 16384;
+
+        using result_t = ::result<bool, std::string>;
+
+        struct node_t
+        {
+            std::string host;
+            std::uint16_t port = end_point::DEFAULT_PORT;
+        };
+
+        // we only need one of the servers to find all the others
+        explicit cluster_end_point(std::vector<node_t> seeds, end_point::timeout_t to = {});
+
+        explicit cluster_end_point(const std::string& host, std::uint16_t port = end_point::DEFAULT_PORT);
+
+        // use this end point with any of the other classes - rmap, rstring, pipeline ..
+        auto get() -> end_point&;
+
+        // reload the slot table from the cluster
+        auto refresh() -> result_t;
+
+        // the servers that owns slots in the cluster
+        auto nodes() const -> std::vector<node_t>;
+
+        // the server that owns the slot of this key
+        auto node_for(std::string_view key) const -> node_t;
+
+        // open a new connection to the node, that is not used by the end point - this is for
+        // connections that can only be used for one thing, for example subscriptions
+        auto connect(const node_t& node, end_point& to) const -> end_point::result_t;
+
+        // the hash slot of a key - honoring {hash tags}
+        static auto slot(std::string_view key) -> std::uint16_t;
+
+    private:
+        end_point front;
+        std::shared_ptr<details::cluster_router> router;
+    };
+}   // end of namespace redis
+
@@ -0,0 +1,117 @@
+#include "redis_coalescing_publisher.h"
+#include "rediscpp/internal/commands.h"
+#include "rediscpp/internal/pubsub.h"
+#include <utility>
+
+namespace redis
+{
+
+coalescing_publisher::coalescing_publisher(const channel& c) :
+    coalescing_publisher(c, options{})
+{
+}
+
+coalescing_publisher::coalescing_publisher(const channel& c, options opts) :
+    comm{c}, config{opts}
+{
+    if (!comm.by()) {
+        throw connection_error("trying to create publisher with invalid redis endpoint object");
+    }
+    filling = std::make_unique<pipeline>(comm.by());
+    flusher.start([this]() { return due(); }, [this]() { flush(); });
+}
+
+coalescing_publisher::~coalescing_publisher()
+{
+    flusher.stop();
+    flush();
+}
+
+auto coalescing_publisher::append(std::string_view message) -> queued&
+{
+    if (filling->empty()) {
+        first = std::chrono::steady_clock::now();
+    }
+    waiting.push_back(queued{
+        internal::queue<result::integer>(*filling, internal::pubsub::publish_command(comm.sharded()), comm.name(), message), {}
+    });
+    return waiting.back();
+}
+
+auto coalescing_publisher::due() const -> internal::worker::clock_type::time_point
+{
+    if (filling->empty()) {
+        return internal::worker::NEVER;
+    }
+    return filling->encoder().size() >= config.max_bytes ? internal::worker::NOW : first + config.window;
+}
+
+auto coalescing_publisher::send(std::string_view message) -> void
+{
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const auto was_empty = filling->empty();
+        append(message);
+        full = filling->encoder().size() >= config.max_bytes;
+        if (!was_empty && !full) {
+            return;     // the background thread already knows about this batch
+        }
+    }
+    flusher.wake();
+}
+
+auto coalescing_publisher::send_tracked(std::string_view message) -> std::future<delivery_t>
+{
+    std::future<delivery_t> out;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        out = append(message).delivered.emplace().get_future();
+    }
+    flusher.wake();
+    return out;
+}
+
+auto coalescing_publisher::flush() -> void
+{
+    std::lock_guard<std::mutex> in_order(sending);
+    std::unique_ptr<pipeline> batch;
+    std::vector<queued> replies;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (filling->empty()) {
+            return;
+        }
+        batch = std::exchange(filling, std::make_unique<pipeline>(comm.by()));
+        replies.swap(waiting);
+    }
+    const auto count = batch->size();
+    batch->exec();      // when this fails, so are all the replies
+    std::uint64_t failures = 0;
+    for (auto& q : replies) {
+        const auto delivered = q.reply.get();
+        if (delivered.is_error()) {
+            ++failures;     // either it was not sent, or the server rejected it
+        }
+        if (!q.delivered) {
+            continue;
+        }
+        if (delivered.is_ok()) {
+            q.delivered->set_value(ok(delivered.unwrap().message()));
+        } else {
+            q.delivered->set_value(failed(delivered.error_value()));
+        }
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    ++counters.flushes;
+    counters.messages += count;
+    counters.failures += failures;
+}
+
+auto coalescing_publisher::statistics() const -> stats
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return counters;
+}
+
+}   // end of namespace redis
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "redis_channel.h"
+#include "redis_pipeline.h"
+#include "rediscpp/internal/worker.h"
+#include "result/results.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <future>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * each publisher::send is a full round trip to the server. When there are many small
+ * messages, most of the time is spent waiting for the replies. The coalescing publisher
+ * is only buffering the messages, and a background thread is sending all the messages that
+ * were buffered in one pipelined write, once the window time passed since the first message
+ * in the buffer, or once the buffer is large enough. The order of the messages is kept.
+ * The end point is used by the background thread, so don't use it for anything else while this is alive.
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        channel events("events", connection);
+        coalescing_publisher::options opts;
+        opts.window = std::chrono::milliseconds{2};
+        coalescing_publisher sender(events, opts);
+        sender.send("fire and forget");
+        auto delivered = sender.send_tracked("I care about this one");
+        // .. later
+        const auto count = delivered.get();     // number of subscribers that got it, or error
+    */
+    struct coalescing_publisher
+    {
+        using milliseconds_t = end_point::milliseconds_t;
+        using delivery_t = ::result<std::int64_t, std::string>;
+
+        struct options
+        {
+            milliseconds_t window = milliseconds_t{1};  // the longest time that a message is waiting in the buffer
+            std::size_t max_bytes = 64 * 1024;          // send once we have at least this much
+        };
+
+        struct stats
+        {
+            std::uint64_t messages = 0;     // messages that were sent to the server
+            std::uint64_t flushes = 0;      // number of writes to the server
+            std::uint64_t failures = 0;     // messages that failed to be published
+        };
+
+        explicit coalescing_publisher(const channel& c);
+
+        coalescing_publisher(const channel& c, options opts);
+
+        // whatever is still in the buffer is sent before this returns
+        ~coalescing_publisher();
+
+        coalescing_publisher(const coalescing_publisher&) = delete;
+        coalescing_publisher& operator = (const coalescing_publisher&) = delete;
+
+        // can be called from any thread
+        auto send(std::string_view message) -> void;
+
+        // same as above, with the number of subscribers that received it, once it was sent
+        auto send_tracked(std::string_view message) -> std::future<delivery_t>;
+
+        // send whatever is in the buffer now, without waiting for the window
+        auto flush() -> void;
+
+        auto statistics() const -> stats;
+
+    private:
+        // every message is kept until it is sent, so we know if it failed
+        struct queued
+        {
+            deferred<result::integer> reply;
+            std::optional<std::promise<delivery_t>> delivered;     // only for send_tracked
+        };
+
+        // must be called with the lock held
+        auto append(std::string_view message) -> queued&;
+
+        // when the background thread should send the buffer
+        auto due() const -> internal::worker::clock_type::time_point;
+
+        channel comm;
+        options config;
+        mutable std::mutex lock;                    // for the buffer
+        std::mutex sending;                         // so that the batches are sent in the order they were filled
+        std::unique_ptr<pipeline> filling;
+        std::vector<queued> waiting;
+        std::chrono::steady_clock::time_point first;    // when the first message in the buffer was added
+        stats counters;
+        internal::worker flusher{lock};
+    };
+}   // end of namespace redis
+
@@ -0,0 +1,244 @@
+#include "redis_connection_pool.h"
+#include <hiredis/hiredis.h>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace redis
+{
+
+using namespace std::string_literals;
+
+namespace details
+{
+
+using clock_type = std::chrono::steady_clock;
+
+struct pooled_connection
+{
+    end_point connection;
+    std::size_t in_flight = 0;      // number of leases that are currently using this connection
+    clock_type::time_point last_used = clock_type::now();
+};
+
+struct pool_state : std::enable_shared_from_this<pool_state>
+{
+    using opener_t = std::function<end_point::result_t (end_point&)>;
+    using slot_ptr = std::unique_ptr<pooled_connection>;
+
+    pool_state(opener_t op, connection_pool::options opts) :
+        opener{std::move(op)}, config{opts} {
+        if (config.max_size == 0) {
+            config.max_size = 1;
+        }
+        config.min_size = std::min(config.min_size, config.max_size);
+    }
+
+    auto warm_up() -> void {
+        for (std::size_t i = 0; i < config.min_size; ++i) {
+            auto s = std::make_unique<pooled_connection>();
+            if (const auto e = Error(opener(s->connection)); e) {
+                throw connection_error{"failed to open pooled connection: " + e.value()};
+            }
+            slots.push_back(std::move(s));
+            ++counters.opened;
+        }
+    }
+
+    // choose the connection with the least number of operations in flight - since
+    // leases are exclusive, only a connection with nothing in flight can be used.
+    // on ties, prefer the one that was used last, so that the rest would turn idle
+    // and can be reaped
+    auto select() -> pooled_connection* {
+        pooled_connection* best = nullptr;
+        for (auto& s : slots) {
+            if (s->in_flight != 0) {
+                continue;
+            }
+            if (!best || s->last_used > best->last_used) {
+                best = s.get();
+            }
+        }
+        return best;
+    }
+
+    auto make_lease(pooled_connection* s) -> connection_pool::lease {
+        ++s->in_flight;
+        ++counters.checkouts;
+        auto self = shared_from_this();
+        return connection_pool::lease{std::shared_ptr<pooled_connection>(s, [self](pooled_connection* p) {
+            self->give_back(p);
+        })};
+    }
+
+    auto checkout(connection_pool::milliseconds_t wait) -> ::result<connection_pool::lease, std::string> {
+        const auto deadline = clock_type::now() + wait;
+        std::unique_lock<std::mutex> guard{lock};
+        while (true) {
+            if (auto s = select(); s) {
+                return ok(make_lease(s));
+            }
+            if (slots.size() + opening < config.max_size) {
+                // open the new connection without holding the lock, as this is a network operation
+                ++opening;
+                guard.unlock();
+                auto s = std::make_unique<pooled_connection>();
+                const auto r = opener(s->connection);
+                guard.lock();
+                --opening;
+                if (const auto e = Error(r); e) {
+                    condition.notify_one();     // someone else may try to open it
+                    return failed("failed to open pooled connection: " + e.value());
+                }
+                ++counters.opened;
+                slots.push_back(std::move(s));
+                return ok(make_lease(slots.back().get()));
+            }
+            ++waiting;
+            const auto status = condition.wait_until(guard, deadline);
+            --waiting;
+            if (status == std::cv_status::timeout && !select() && slots.size() + opening >= config.max_size) {
+                ++counters.timeouts;
+                return failed("timeout while waiting for free connection in the pool"s);
+            }
+        }
+    }
+
+    auto give_back(pooled_connection* s) -> void {
+        {
+            const auto now = clock_type::now();
+            std::lock_guard<std::mutex> guard{lock};
+            --s->in_flight;
+            s->last_used = now;
+            if (s->in_flight == 0 && broken(*s)) {
+                remove(s);      // s is gone after this
+                ++counters.dropped;
+            }
+            reap(now);
+        }
+        condition.notify_one();
+    }
+
+    auto reap(clock_type::time_point now) -> std::size_t {
+        std::size_t count = 0;
+        for (auto i = slots.begin(); i != slots.end() && slots.size() > config.min_size;) {
+            if ((*i)->in_flight == 0 && now - (*i)->last_used > config.idle_timeout) {
+                i = slots.erase(i);
+                ++count;
+            } else {
+                ++i;
+            }
+        }
+        counters.reaped += count;
+        return count;
+    }
+
+    auto remove(pooled_connection* s) -> void {
+        slots.erase(std::remove_if(slots.begin(), slots.end(), [s](const auto& p) {
+            return p.get() == s;
+        }), slots.end());
+    }
+
+    // a connection that was closed by its user, or that got into error state cannot be reused
+    static auto broken(pooled_connection& s) -> bool {
+        if (!s.connection) {
+            return true;
+        }
+        return cast(s.connection)->err != 0;
+    }
+
+    auto statistics() const -> connection_pool::stats {
+        std::lock_guard<std::mutex> guard{lock};
+        auto out = counters;
+        out.size = slots.size();
+        out.in_use = static_cast<std::size_t>(std::count_if(slots.begin(), slots.end(), [](const auto& s) {
+            return s->in_flight != 0;
+        }));
+        out.idle = out.size - out.in_use;
+        out.waiting = waiting;
+        return out;
+    }
+
+    opener_t opener;
+    connection_pool::options config;
+    mutable std::mutex lock;
+    std::condition_variable condition;
+    std::vector<slot_ptr> slots;
+    std::size_t opening = 0;    // connections that are being opened right now
+    std::size_t waiting = 0;
+    connection_pool::stats counters;
+};
+
+}   // end of namespace details
+
+connection_pool::lease::lease(std::shared_ptr<details::pooled_connection> s) : slot{std::move(s)}
+{
+}
+
+auto connection_pool::lease::get() const -> end_point&
+{
+    if (!slot) {
+        throw connection_error("trying to use empty connection lease");
+    }
+    return slot->connection;
+}
+
+auto connection_pool::lease::release() -> void
+{
+    slot.reset();
+}
+
+connection_pool::connection_pool(const std::string& host, options opts, std::uint16_t port) :
+    state{std::make_shared<details::pool_state>([host, port](end_point& ep) {
+        return ep.open(host, port);
+    }, opts)}
+{
+    state->warm_up();
+}
+
+connection_pool::connection_pool(const std::string& host, end_point::timeout_t to, options opts, std::uint16_t port) :
+    state{std::make_shared<details::pool_state>([host, to, port](end_point& ep) {
+        return ep.open(host, to, port);
+    }, opts)}
+{
+    state->warm_up();
+}
+
+connection_pool::connection_pool(end_point::named_pipe_t pipe, options opts) :
+    state{std::make_shared<details::pool_state>([pipe](end_point& ep) {
+        return ep.open(pipe);
+    }, opts)}
+{
+    state->warm_up();
+}
+
+auto connection_pool::checkout() -> lease
+{
+    auto r = state->checkout(state->config.checkout_timeout);
+    if (r.is_error()) {
+        throw connection_error(r.error_value());
+    }
+    return r.unwrap();
+}
+
+auto connection_pool::try_checkout(milliseconds_t wait) -> ::result<lease, std::string>
+{
+    return state->checkout(wait);
+}
+
+auto connection_pool::reap_idle() -> std::size_t
+{
+    std::lock_guard<std::mutex> guard{state->lock};
+    return state->reap(details::clock_type::now());
+}
+
+auto connection_pool::statistics() const -> stats
+{
+    return state->statistics();
+}
+
+}   // end of namespace redis
+
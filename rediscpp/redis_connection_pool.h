@@ -0,0 +1,114 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * copying an end_point only copies the handle to the hiredis context - all the copies
+ * are talking over the same socket, and hiredis context is not thread safe. So if
+ * we have more than one thread that needs to talk to the server, each of them must
+ * have its own connection. This pool is managing a set of connections to the same
+ * server and hands them out to threads, making sure that no two threads are using the
+ * same connection at the same time.
+ **/
+
+namespace redis
+{
+    /* usage:
+        connection_pool::options opts;
+        opts.min_size = 4;
+        opts.max_size = 32;
+        connection_pool pool("localhost", opts);
+        // from any thread
+        {
+            auto lease = pool.checkout();     // would block up to opts.checkout_timeout
+            rmap cache(lease.get());
+            cache.insert("foo", "bar");
+            // do not keep copies of the end_point (or proxies made from it) after
+            // the lease goes out of scope - at that point it would be given to other thread
+        }   // the connection is back in the pool
+    */
+    namespace details
+    {
+        struct pool_state;
+        struct pooled_connection;
+    }   // end of namespace details
+
+    struct connection_pool
+    {
+        using milliseconds_t = end_point::milliseconds_t;
+
+        struct options
+        {
+            std::size_t min_size = 1;               // number of connections that are kept open even when idle
+            std::size_t max_size = 8;               // never open more than this number of connections
+            milliseconds_t idle_timeout = std::chrono::minutes{1};      // close idle connections above min_size after this
+            milliseconds_t checkout_timeout = std::chrono::seconds{5};  // how long to wait for a free connection
+        };
+
+        struct stats
+        {
+            std::size_t size = 0;       // number of open connections
+            std::size_t idle = 0;       // connections that are waiting in the pool
+            std::size_t in_use = 0;     // connections that are leased
+            std::size_t waiting = 0;    // threads that are blocked on checkout
+            std::uint64_t checkouts = 0;
+            std::uint64_t timeouts = 0; // checkouts that failed since no connection was free in time
+            std::uint64_t opened = 0;   // total number of connections that we opened
+            std::uint64_t reaped = 0;   // total number of connections that we closed since they were idle
+            std::uint64_t dropped = 0;  // connections that returned broken and were closed
+        };
+
+        // a connection that was taken from the pool. As long as this (or a copy of it)
+        // is alive the connection belongs to the thread that took it. Once the last copy
+        // is gone, the connection returns to the pool
+        struct lease
+        {
+            lease() = default;
+
+            auto get() const -> end_point&;
+
+            explicit operator bool () const {
+                return static_cast<bool>(slot);
+            }
+
+            // return the connection to the pool before the lease goes out of scope
+            auto release() -> void;
+
+        private:
+            friend struct details::pool_state;
+
+            explicit lease(std::shared_ptr<details::pooled_connection> s);
+
+            std::shared_ptr<details::pooled_connection> slot;
+        };
+
+        connection_pool(const std::string& host, options opts, std::uint16_t port = end_point::DEFAULT_PORT);
+
+        connection_pool(const std::string& host, end_point::timeout_t to, options opts, std::uint16_t port = end_point::DEFAULT_PORT);
+
+        connection_pool(end_point::named_pipe_t pipe, options opts);
+
+        // take a connection from the pool - throws connection_error if we failed to get
+        // one within options::checkout_timeout
+        auto checkout() -> lease;
+
+        // same as above, but wait at most for the given time and return an error instead of throwing
+        auto try_checkout(milliseconds_t wait) -> ::result<lease, std::string>;
+
+        // close connections that were idle for more than options::idle_timeout, while
+        // keeping at least options::min_size of them. This is called on every return of
+        // connection as well, so normally there is no need to call it. Returns the number of closed connections
+        auto reap_idle() -> std::size_t;
+
+        auto statistics() const -> stats;
+
+    private:
+        std::shared_ptr<details::pool_state> state;
+    };
+}   // end of namespace redis
+
@@ -1,4 +1,5 @@
 #include "redis_endpoint.h"
+#include "rediscpp/internal/commands.h"
 #include <hiredis/hiredis.h>
 
 #ifdef WIN32
@@ -28,6 +29,32 @@ namespace
         return c;
     }
 
+    // the server is sending us ["invalidate", [keys..]], or ["invalidate", null] when it
+    // was flushing all the keys
+    auto invalidate(near_cache& cache, const result::array& message) -> void
+    {
+        if (message.size() != 2) {
+            return;
+        }
+        const auto kind = result::try_into<result::string>(message.view(0));
+        if (kind.is_error() || kind.unwrap().message() != "invalidate") {
+            return;     // this is some other push message
+        }
+        const auto keys = message.view(1);
+        if (keys.is_null()) {
+            cache.clear();
+            return;
+        }
+        if (const auto list = keys.as_array(); list.is_ok()) {
+            const auto& l = list.unwrap();
+            for (std::size_t i = 0; i < l.size(); ++i) {
+                if (const auto k = result::try_into<result::string>(l.view(i)); k.is_ok()) {
+                    cache.invalidate(result::to_string(k.unwrap()));
+                }
+            }
+        }
+    }
+
 
 }   // end of local namespace
 
@@ -122,9 +149,11 @@ auto end_point::finalized(redisContext* rc) -> result_t
 {
     // make sure that we don't have error before using this connection
     if (!rc || rc->err) {
+        free_connection(rc);
         return failed("we are in invalid state - cannot start connection"s);
     } else {
         connection.reset(rc, free_connection);
+        io = std::make_shared<internal::resp::connection>();
         return ok(true);
     }
 
@@ -137,7 +166,8 @@ end_point::operator boolean_type () const
 
 auto end_point::close_it() -> void
 {
-    finalized(nullptr);
+    connection.reset();
+    io.reset();
 }
 
 auto end_point::open(named_pipe_t pipe) -> result_t {
@@ -147,6 +177,7 @@ auto end_point::open(named_pipe_t pipe) -> result_t {
     auto r = redisConnectUnixWithTimeout(pipe.name.c_str(), tv);
     if (r) {
         connection.reset(r, free_connection);
+        io = std::make_shared<internal::resp::connection>();
     }
     switch (r != nullptr) {
         case true:
@@ -164,6 +195,94 @@ auto end_point::set_timeout(const timeout_t& to) -> void
     }
 }
 
+auto end_point::enable_cache(const near_cache::options& opts) -> result_t
+{
+    if (!connection) {
+        return failed("not connected"s);
+    }
+    if (buffers(*this).route) {
+        return failed("near cache is not supported when the commands are routed to more than one server"s);
+    }
+    if (buffers(*this).cache) {
+        if (const auto e = Error(disable_cache()); e) {
+            return failed(e.value());
+        }
+    }
+    // invalidation messages can only be sent on the same connection with RESP3
+    if (const auto e = Error(internal::run_op(*this, "HELLO", 3)); e) {
+        return failed("failed to switch to RESP3 (redis 6 or later is required): " + e.value());
+    }
+    auto& state = buffers(*this);
+    const auto broadcast = opts.mode == near_cache::mode_t::BROADCAST;
+    state.out.clear();
+    state.out.begin(3 + (broadcast ? 1 + opts.prefixes.size() * 2 : 0)).arg("CLIENT").arg("TRACKING").arg("ON");
+    if (broadcast) {
+        state.out.arg("BCAST");
+        for (const auto& p : opts.prefixes) {
+            state.out.arg("PREFIX").arg(p);
+        }
+    }
+    if (const auto e = Error(internal::run_encoded(*this)); e) {
+        return failed("failed to enable client tracking: " + e.value());
+    }
+    state.cache = std::make_unique<near_cache>(opts);
+    state.in.on_push([cache = state.cache.get()](const result::array& message) {
+        invalidate(*cache, message);
+    });
+    return ok(true);
+}
+
+auto end_point::disable_cache() -> result_t
+{
+    if (!connection || !buffers(*this).cache) {
+        return ok(true);
+    }
+    auto& state = buffers(*this);
+    state.in.on_push(nullptr);
+    state.cache.reset();
+    if (const auto e = Error(internal::run_op(*this, "CLIENT", "TRACKING", "OFF")); e) {
+        return failed("failed to disable client tracking: " + e.value());
+    }
+    // so that hiredis would be able to read the replies again
+    if (const auto e = Error(internal::run_op(*this, "HELLO", 2)); e) {
+        return failed("failed to switch back to RESP2: " + e.value());
+    }
+    return ok(true);
+}
+
+auto end_point::cache_statistics() const -> std::optional<near_cache::stats>
+{
+    if (!connection || !io || !io->cache) {
+        return {};
+    }
+    return io->cache->statistics();
+}
+
+auto near_cache_of(end_point& from) -> near_cache*
+{
+    return from && from.io ? from.io->cache.get() : nullptr;
+}
+
+auto routed(end_point& over, std::shared_ptr<internal::router> route) -> end_point
+{
+    if (!over) {
+        throw connection_error("redis end point object not valid!");
+    }
+    end_point out;
+    out.connection = over.connection;
+    out.io = std::make_shared<internal::resp::connection>();
+    out.io->route = std::move(route);
+    return out;
+}
+
+auto buffers(end_point& from) -> internal::resp::connection&
+{
+    if (!from || !from.io) {
+        throw connection_error("redis end point object not valid!");
+    }
+    return *from.io;
+}
+
 connection_error::connection_error(const std::string& err) : std::runtime_error(err)
 {
 }
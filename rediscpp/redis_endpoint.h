@@ -1,6 +1,7 @@
 #pragma once
 
 #include "result/results.h"
+#include "redis_near_cache.h"
 #include <string>
 #include <memory>
 #include <stdexcept>
@@ -27,6 +28,15 @@ struct redisContext;
 
 namespace redis
 {
+    namespace internal
+    {
+        struct router;
+
+        namespace resp
+        {
+            struct connection;
+        }   // end of namespace resp
+    }   // end of namespace internal
     
     struct connection_error : public std::runtime_error
     {
@@ -160,6 +170,15 @@ namespace redis
 
         auto set_timeout(const timeout_t& to) -> void;
 
+        // keep the values that we are reading in the process memory, see redis_near_cache.h.
+        // This requires redis 6 or later, since the connection is switched to RESP3
+        auto enable_cache(const near_cache::options& opts = {}) -> result_t;
+
+        auto disable_cache() -> result_t;
+
+        // empty if the cache is not enabled
+        auto cache_statistics() const -> std::optional<near_cache::stats>;
+
         friend auto cast(end_point& from) -> redisContext* {
             if (from) {
                 return from.connection.get();
@@ -169,6 +188,17 @@ namespace redis
             }
         }
 
+        // the buffers that we are using to talk to the server over this connection
+        friend auto buffers(end_point& from) -> internal::resp::connection&;
+
+        // the near cache of this connection, or null if it is not enabled
+        friend auto near_cache_of(end_point& from) -> near_cache*;
+
+        // this is for internal use - an end point that is passing its commands to the router. It is
+        // holding the same connection as the given one (that the router is using), so it doesn't
+        // need a connection of its own
+        friend auto routed(end_point& over, std::shared_ptr<internal::router> route) -> end_point;
+
     private:
         auto dummy() const -> void {}
 
@@ -183,7 +213,9 @@ namespace redis
 
     private:
         using data_type = std::shared_ptr<redisContext>;
+        using buffers_type = std::shared_ptr<internal::resp::connection>;
         data_type connection;
+        buffers_type io;
     };
 }   // end of namespace redis
 
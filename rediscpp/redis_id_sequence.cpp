@@ -0,0 +1,166 @@
+#include "redis_id_sequence.h"
+#include "rediscpp/internal/commands.h"
+#include <algorithm>
+
+namespace redis
+{
+
+namespace
+{
+    // the state is the generation of the current block in the high bits, and the next offset in it
+    constexpr unsigned GENERATION_SHIFT = 48;
+    constexpr std::uint64_t OFFSET_MASK = (std::uint64_t{1} << GENERATION_SHIFT) - 1;
+    constexpr std::uint64_t GENERATION_MASK = 0xFFFF;
+    constexpr auto INVALID_GENERATION = ~std::uint64_t{0};
+}   // end of local namespace
+
+id_sequence::id_sequence(end_point ep, std::string name) :
+    id_sequence(std::move(ep), std::move(name), options{})
+{
+}
+
+id_sequence::id_sequence(end_point ep, std::string name, options opts) :
+    connection{std::move(ep)}, key{std::move(name)}, config{opts},
+    block_size{std::clamp(opts.block, std::max<std::uint64_t>(opts.min_block, 1), std::max(opts.max_block, opts.min_block))}
+{
+    const auto first = reserve(block_size);
+    if (first.is_error()) {
+        throw connection_error(first.error_value());
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        install(first.unwrap());
+        ++counters.blocks;
+    }
+    reserver.start([this]() {
+        return wanted && !spare && !error ? internal::worker::NOW : internal::worker::NEVER;
+    }, [this]() {
+        reserve_next();
+    });
+}
+
+id_sequence::~id_sequence()
+{
+    reserver.stop();
+    ready.notify_all();     // whoever is waiting for a block would not get it
+}
+
+auto id_sequence::next() -> value_type
+{
+    while (true) {
+        const auto s = state.fetch_add(1, std::memory_order_acq_rel);
+        const auto generation = s >> GENERATION_SHIFT;
+        const auto offset = s & OFFSET_MASK;
+        const auto& b = blocks[generation % BLOCKS];
+        // the block may be replaced while we are reading it, so make sure it is the same before and after
+        const auto before = b.generation.load(std::memory_order_acquire);
+        const auto first = b.first.load(std::memory_order_relaxed);
+        const auto size = b.size.load(std::memory_order_relaxed);
+        const auto trigger = b.trigger.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const auto after = b.generation.load(std::memory_order_relaxed);
+        if (before == generation && after == generation && offset < size) {
+            if (offset == trigger) {
+                // only one thread is getting here for each block
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    wanted = true;
+                }
+                reserver.wake();
+            }
+            return first + offset;
+        }
+        refill(generation);
+    }
+}
+
+auto id_sequence::refill(std::uint64_t generation) -> void
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        if ((state.load(std::memory_order_acquire) >> GENERATION_SHIFT) != generation) {
+            return;     // some other thread already moved to the next block
+        }
+        if (spare) {
+            install(*spare);
+            spare.reset();
+            return;
+        }
+        if (error) {
+            const auto e = std::move(*error);
+            error.reset();
+            throw connection_error("failed to reserve ids for " + key + ": " + e);
+        }
+        if (reserver.stopped()) {
+            throw connection_error("the id sequence for " + key + " was stopped");
+        }
+        wanted = true;
+        ++counters.waits;
+        reserver.wake();
+        ready.wait(guard);
+    }
+}
+
+auto id_sequence::install(const range& r) -> void
+{
+    const auto generation = ((state.load(std::memory_order_acquire) >> GENERATION_SHIFT) + 1) & GENERATION_MASK;
+    auto& b = blocks[generation % BLOCKS];
+    b.generation.store(INVALID_GENERATION, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    b.first.store(r.first, std::memory_order_relaxed);
+    b.size.store(r.size, std::memory_order_relaxed);
+    const auto left = std::max<std::uint64_t>(static_cast<std::uint64_t>(static_cast<double>(r.size) * config.low_watermark), 1);
+    b.trigger.store(r.size > left ? r.size - left : 0, std::memory_order_relaxed);
+    b.generation.store(generation, std::memory_order_release);
+    state.store(generation << GENERATION_SHIFT, std::memory_order_release);
+
+    // the next block should last about the target time
+    const auto now = std::chrono::steady_clock::now();
+    if (installed != std::chrono::steady_clock::time_point{}) {
+        const auto took = now - installed;
+        if (took < config.target / 2) {
+            block_size = std::min(block_size * 2, std::max(config.max_block, config.min_block));
+        } else if (took > config.target * 2) {
+            block_size = std::max(block_size / 2, std::max<std::uint64_t>(config.min_block, 1));
+        }
+    }
+    installed = now;
+}
+
+auto id_sequence::reserve(std::uint64_t size) -> ::result<range, std::string>
+{
+    const auto r = internal::process<result::integer>::run(connection, "INCRBY", key, size);
+    if (r.is_error()) {
+        return failed(r.error_value());
+    }
+    // INCRBY returns the last id in the block
+    const auto last = static_cast<value_type>(r.unwrap().message());
+    return ok(range{last - size + 1, size});
+}
+
+auto id_sequence::reserve_next() -> void
+{
+    std::unique_lock<std::mutex> guard(lock);
+    const auto size = block_size;
+    guard.unlock();
+    auto r = reserve(size);
+    guard.lock();
+    if (r.is_ok()) {
+        spare = r.unwrap();
+        ++counters.blocks;
+    } else {
+        error = r.error_value();
+    }
+    wanted = false;
+    ready.notify_all();
+}
+
+auto id_sequence::statistics() const -> stats
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto out = counters;
+    out.block_size = block_size;
+    return out;
+}
+
+}   // end of namespace redis
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include "rediscpp/internal/worker.h"
+#include "result/results.h"
+#include <string>
+#include <optional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * using ++long_int to generate unique ids is a round trip to the server for each id. The id
+ * sequence is reserving a block of ids at once (INCRBY with the block size) and then hands
+ * them out locally - getting an id is a single atomic add. Before the current block is used up
+ * (once we pass the low watermark), a background thread is reserving the next block, so normally
+ * we never wait for the server. The size of the block is adapted to the rate that we are
+ * using the ids - we are trying to reserve a block every target interval.
+ * The ids are unique across all the processes that are using the same key, and in each process they are
+ * increasing, but the ids from different processes are interleaved, and the ids that were reserved
+ * and not used when the process exits are lost (so there are gaps).
+ * The blocks are reserved over the end point that is given here, mostly from the background
+ * thread, so the sequence needs an end point that nothing else is using.
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        id_sequence::options opts;
+        opts.target = std::chrono::seconds{1};     // reserve about a block a second
+        id_sequence orders(connection, "order ids", opts);
+        // from any thread
+        const auto id = orders.next();
+    */
+    struct id_sequence
+    {
+        using value_type = std::uint64_t;
+        using milliseconds_t = end_point::milliseconds_t;
+
+        struct options
+        {
+            std::uint64_t block = 1000;         // the size of the first block
+            std::uint64_t min_block = 16;
+            std::uint64_t max_block = 1 << 20;
+            double low_watermark = 0.25;        // reserve the next block once this part of the current block is left
+            milliseconds_t target = std::chrono::seconds{1};   // the time that we want each block to last
+        };
+
+        struct stats
+        {
+            std::uint64_t blocks = 0;       // the number of blocks that we reserved
+            std::uint64_t waits = 0;        // the number of times that we had to wait for a block
+            std::uint64_t block_size = 0;   // the size of the next block that we would reserve
+        };
+
+        // throws connection_error if we failed to reserve the first block
+        id_sequence(end_point ep, std::string name);
+
+        id_sequence(end_point ep, std::string name, options opts);
+
+        ~id_sequence();
+
+        id_sequence(const id_sequence&) = delete;
+        id_sequence& operator = (const id_sequence&) = delete;
+
+        // can be called from any thread. throws connection_error if we need a new block and failed to get it
+        auto next() -> value_type;
+
+        auto statistics() const -> stats;
+
+    private:
+        struct range
+        {
+            value_type first = 0;
+            std::uint64_t size = 0;
+        };
+
+        // the blocks are used in turns, the generation of the block is kept in the state, and in
+        // the block itself, so we can tell if the block was replaced while we were reading it
+        struct block
+        {
+            std::atomic<std::uint64_t> generation{~std::uint64_t{0}};
+            std::atomic<value_type> first{0};
+            std::atomic<std::uint64_t> size{0};
+            std::atomic<std::uint64_t> trigger{0};      // when we get here, we need the next block
+        };
+
+        static constexpr std::size_t BLOCKS = 4;
+
+        // reserve a block at the server
+        auto reserve(std::uint64_t size) -> ::result<range, std::string>;
+
+        // called with the lock held
+        auto install(const range& r) -> void;
+
+        // we are out of ids in the generation - move to the next block
+        auto refill(std::uint64_t generation) -> void;
+
+        // the work of the background thread - reserve the next block, so it is ready once we need it
+        auto reserve_next() -> void;
+
+        mutable end_point connection;
+        std::string key;
+        options config;
+        std::atomic<std::uint64_t> state{0};    // the generation in the high bits, and the offset in the current block
+        block blocks[BLOCKS];
+        mutable std::mutex lock;
+        std::condition_variable ready;          // a block was reserved
+        std::optional<range> spare;             // the next block, that was already reserved
+        std::optional<std::string> error;       // the background thread failed to reserve it
+        bool wanted = false;                    // we need the next block
+        std::uint64_t block_size = 0;
+        std::chrono::steady_clock::time_point installed;    // when the current block was installed
+        stats counters;
+        internal::worker reserver{lock};
+    };
+}   // end of namespace redis
+
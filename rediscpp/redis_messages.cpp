@@ -2,9 +2,11 @@
 #include "result/results.h"
 #include "redis_reply.h"
 #include "result/results.h"
+#include "redis_cluster.h"
 #include "rediscpp/internal/commands.h"
 #include <hiredis/hiredis.h>
 #include <boost/algorithm/string.hpp>
+#include <unordered_map>
 #include <iostream>
 
 
@@ -12,7 +14,20 @@ namespace redis
 {
     namespace 
     {
-        
+        // send what we have in the pipeline, and make sure that all the commands were successful
+        template<typename T>
+        auto send(pipeline& batch, std::vector<deferred<T>>& replies) -> void
+        {
+            if (const auto e = Error(batch.exec()); e) {
+                throw connection_error(e.value());
+            }
+            for (const auto& r : replies) {
+                if (const auto e = Error(r.get()); e) {
+                    throw connection_error(e.value());
+                }
+            }
+            replies.clear();
+        }
     }   // end of local namespace
 
     rstring::rstring(end_point ep, const std::string& name) : key_name(name), connection(ep)
@@ -21,10 +36,15 @@ namespace redis
 
     rstring& rstring::operator = (const std::string& value)
     {       
-        internal::process_validate<void>::run(connection,  "SET %s %b", key_name.c_str(), value.data(), value.size());
+        internal::process_validate<void>::run(connection, "SET", key_name, value);
         return *this;
     }
 
+    deferred<result::status> rstring::assign(pipeline& batch, const std::string& value) const
+    {
+        return internal::queue<result::status>(batch, "SET", key_name, value);
+    }
+
     rstring& rstring::operator +=(const std::string& add_str)
     {
         append(add_str);
@@ -33,27 +53,55 @@ namespace redis
 
     void rstring::append(const std::string& add_str)
     {
-        internal::process_validate<void>::run(connection,  "APPEND %s %b", key_name.c_str(), add_str.data(), add_str.size());
+        internal::process_validate<void>::run(connection, "APPEND", key_name, add_str);
+    }
+
+    patch_stats rstring::patch(std::string_view old, std::string_view now, const patch_options& opts)
+    {
+        patch_stats stats;
+        const auto ranges = diff(old, now, opts.merge);
+        for (const auto& r : ranges) {
+            stats.sent += r.length;
+        }
+        // SETRANGE cannot make the value shorter
+        const auto dense = static_cast<double>(stats.sent) > opts.max_ratio * static_cast<double>(now.size());
+        if (now.size() < old.size() || (dense && !ranges.empty())) {
+            internal::process_validate<void>::run(connection, "SET", key_name, now);
+            return patch_stats{now.size(), 0, 0, true};
+        }
+        stats.saved = now.size() - stats.sent;
+        stats.ranges = ranges.size();
+        if (ranges.empty()) {
+            return stats;
+        }
+        pipeline batch(connection);
+        std::vector<deferred<void>> replies;
+        replies.reserve(ranges.size());
+        for (const auto& r : ranges) {
+            replies.push_back(internal::queue<void>(batch, "SETRANGE", key_name, r.offset, now.substr(r.offset, r.length)));
+        }
+        if (const auto e = Error(batch.exec()); e) {
+            throw connection_error("failed to patch " + key_name + ": " + e.value());
+        }
+        for (const auto& r : replies) {
+            if (const auto e = Error(r.get()); e) {
+                throw connection_error("failed to patch " + key_name + ": " + e.value());
+            }
+        }
+        return stats;
     }
 
     std::string rstring::str() const
     {
-        const auto r = internal::process_validate<result::string>::run(connection, "GET %s", key_name.c_str());
+        const auto r = internal::process_validate<result::string>::run(connection, "GET", key_name);
         
         return result::to_string(r);        
     }
     
     std::string::size_type rstring::size() const
     {
-        try {
-            auto s = str();
-            return s.size();
-        } catch (const connection_error& e) {
-            throw e;
-        } catch (...) {
-            return 0;
-        }
-
+        const auto r = internal::process_validate<result::integer>::run(connection, "STRLEN", key_name);
+        return static_cast<std::string::size_type>(r.message());
     }
 
     std::string rstring::substr (const range_type& at) const
@@ -73,17 +121,39 @@ namespace redis
 
     std::string rstring::operator () (int from, int to) const
     {
-        const auto r = internal::process_validate<result::string>::run(connection, "GETRANGE %s %s %s", key_name.c_str(),
-            std::to_string(from).c_str(),
-            std::to_string(to).c_str()
-        );
+        const auto r = internal::process_validate<result::string>::run(connection, "GETRANGE", key_name, from, to);
         
         return result::to_string(r);
     }
 
     void rstring::erase()
     {
-        redisCommand(cast(connection), "DEL %s", key_name.c_str());
+        internal::process<void>::run(connection, "DEL", key_name);
+    }
+
+    const std::string& rstring::name() const
+    {
+        return key_name;
+    }
+
+    end_point& rstring::by() const
+    {
+        return connection;
+    }
+
+    rstring::const_iterator rstring::begin() const
+    {
+        return chars().begin();
+    }
+
+    rstring::const_iterator rstring::end() const
+    {
+        return const_iterator();
+    }
+
+    rstring_chars rstring::chars(const iteration_options& opts) const
+    {
+        return rstring_chars(std::make_shared<details::string_blocks>(connection, key_name, opts));
     }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -100,8 +170,7 @@ namespace redis
 
     bool rmap::insert(const key_type& key, mapped_type value) const
     {
-        const auto r = internal::process_validate<result::status>::run(connection, "SET %s %b", 
-                     key.c_str(), value.data(), value.size());
+        const auto r = internal::process_validate<result::status>::run(connection, "SET", key, value);
       
         return boost::algorithm::iequals(r.message(), "ok");
     }
@@ -111,12 +180,127 @@ namespace redis
         return insert(new_val.first, new_val.second);
     }
 
+    deferred<result::status> rmap::insert(pipeline& batch, const key_type& key, const mapped_type& value) const
+    {
+        return internal::queue<result::status>(batch, "SET", key, value);
+    }
+
+    void rmap::insert_many(const std::vector<value_type>& entries, std::size_t chunk) const
+    {
+        const auto groups = internal::group(connection, entries.size(), chunk, [&entries](auto i) -> const key_type& {
+            return entries[i].first;
+        });
+        pipeline batch(connection);
+        std::vector<deferred<void>> replies;
+        for (const auto& g : groups) {
+            auto& out = batch.encoder();
+            out.begin(1 + g.size() * 2).arg("MSET");
+            for (const auto i : g) {
+                out.arg(entries[i].first).arg(entries[i].second);
+            }
+            replies.emplace_back(batch.track());
+            if (batch.size() >= CHUNKS_PER_WRITE) {
+                send(batch, replies);
+            }
+        }
+        send(batch, replies);
+    }
+
+    void rmap::insert_many(const std::vector<value_type>& entries, ttl_type ttl, std::size_t chunk) const
+    {
+        // MSET cannot set expiration, so these are separate SET commands, a chunk in each write
+        chunk = std::max<std::size_t>(chunk, 1);
+        pipeline batch(connection);
+        std::vector<deferred<void>> replies;
+        for (const auto& [key, value] : entries) {
+            replies.push_back(internal::queue<void>(batch, "SET", key, value, "PX", ttl.count()));
+            if (batch.size() >= chunk) {
+                send(batch, replies);
+            }
+        }
+        send(batch, replies);
+    }
+
+    rmap::range_writer::range_writer(end_point& ep) : batch(ep)
+    {
+    }
+
+    bool rmap::range_writer::routed()
+    {
+        return buffers(batch.connection()).route != nullptr;
+    }
+
+    void rmap::range_writer::track(std::size_t per_write)
+    {
+        replies.emplace_back(batch.track());
+        if (batch.size() >= per_write) {
+            send(batch, replies);
+        }
+    }
+
+    void rmap::range_writer::finish()
+    {
+        send(batch, replies);
+    }
+
     rmap::mapped_type rmap::find(const key_type& key) const
     {
         if (!connection) {
             throw connection_error("trying to use invalid endpoint object to find map entry");
         }
-        return rstring(connection, key).str();
+        const auto r = internal::read_through(connection, "GET", key);
+        if (r.is_error()) {
+            throw connection_error(r.error_value());
+        }
+        return r.unwrap();
+    }
+
+    deferred<result::string> rmap::find(pipeline& batch, const key_type& key) const
+    {
+        return internal::queue<result::string>(batch, "GET", key);
+    }
+
+    std::vector<std::optional<rmap::mapped_type>> rmap::find_many(const std::vector<key_type>& keys, std::size_t chunk) const
+    {
+        std::vector<std::optional<mapped_type>> values(keys.size());
+        const auto groups = internal::group(connection, keys.size(), chunk, [&keys](auto i) -> const key_type& {
+            return keys[i];
+        });
+        pipeline batch(connection);
+        std::vector<deferred<result::array>> replies;
+        std::size_t first = 0;      // the group of the first reply that we are waiting for
+        const auto read = [&]() {
+            if (const auto e = Error(batch.exec()); e) {
+                throw connection_error(e.value());
+            }
+            for (const auto& r : replies) {
+                const auto found = r.get();
+                if (found.is_error()) {
+                    throw connection_error(found.error_value());
+                }
+                const auto& g = groups[first++];
+                const auto& a = found.unwrap();
+                for (std::size_t j = 0; j < g.size() && j < a.size(); ++j) {
+                    if (const auto v = a.view(j).as_string(); v.is_ok()) {
+                        values[g[j]] = result::to_string(v.unwrap());
+                    }
+                }
+            }
+            replies.clear();
+        };
+        for (const auto& g : groups) {
+            auto& out = batch.encoder();
+            out.begin(1 + g.size()).arg("MGET");
+            for (const auto i : g) {
+                out.arg(keys[i]);
+            }
+            replies.emplace_back(batch.track());
+            if (batch.size() >= CHUNKS_PER_WRITE) {
+                read();
+            }
+        }
+        read();
+        return values;
     }
 
     void rmap::erase(const key_type& k) const
@@ -125,7 +309,7 @@ namespace redis
             throw connection_error("trying to use invalid endpoint object to delete map entry");
         }
 
-        redisCommand(cast(connection), "DEL %s", k.c_str());
+        internal::process<void>::run(connection, "DEL", k);
     }
 
     std::size_t  rmap::size() const
@@ -136,7 +320,21 @@ namespace redis
 
     bool rmap::empty() const
     {
-        return size() != 0;
+        return size() == 0;
+    }
+
+    key_scan rmap::scan(const std::string& pattern, std::size_t count_hint, const std::string& type) const
+    {
+        scan_options opts;
+        opts.pattern = pattern;
+        opts.count = count_hint;
+        opts.type = type;
+        return scan(opts);
+    }
+
+    key_scan rmap::scan(const scan_options& opts) const
+    {
+        return key_scan(connection, opts);
     }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -157,7 +355,7 @@ namespace redis
             return std::string(s2.data(), s2.size());
         };
 
-        const auto r = internal::process<result::status>::run(connection, "SET %s %s", name.c_str(), std::to_string(v).c_str());
+        const auto r = internal::process<result::status>::run(connection, "SET", name, v);
         auto em = extract(r);
         if (!boost::algorithm::iequals(em, "ok")) {
             throw connection_error(std::string(em.data(), em.size()));
@@ -167,7 +365,7 @@ namespace redis
     long_int& long_int::operator = (value_type val)
     {
         constexpr std::string_view expected = "ok";
-        const auto r = internal::process<result::status>::run(connection, "SET %s %s", name.c_str(), std::to_string(val).c_str());
+        const auto r = internal::process<result::status>::run(connection, "SET", name, val);
         const auto em = r.is_error() ? r.error_value() : r.unwrap().message();
         if (!boost::algorithm::iequals(em, expected)) {
             throw connection_error(std::string(em.data(), em.size()));
@@ -177,14 +375,14 @@ namespace redis
     
     long_int::operator long_int::value_type () const
     {
-        const auto r = internal::process_validate<result::integer>::run(connection, "GET %s", name.c_str());        
+        const auto r = internal::process_validate<result::integer>::run(connection, "GET", name);        
         
         return r.message();
     }
 
     long_int::value_type long_int::operator ++ () const
     {
-        const auto r = internal::process_validate<result::integer>::run(connection, "INCR %s", name.c_str());
+        const auto r = internal::process_validate<result::integer>::run(connection, "INCR", name);
               
         return r.message();
     }
@@ -193,13 +391,13 @@ namespace redis
     {
         auto i = this->operator()();
         
-        redisCommand(cast(connection), "INCR %s", name.c_str());
+        internal::process<void>::run(connection, "INCR", name);
         return i;
     }
 
     long_int::value_type long_int::operator -- () const
     {  
-        const auto r = internal::process_validate<result::integer>::run(connection, "DECR %s", name.c_str());
+        const auto r = internal::process_validate<result::integer>::run(connection, "DECR", name);
              
         return r.message();
     }
@@ -208,24 +406,34 @@ namespace redis
     {
         auto i = this->operator()();
         
-        redisCommand(cast(connection), "DECR %s", name.c_str());
+        internal::process<void>::run(connection, "DECR", name);
         return i;
     }
         
     long_int::value_type long_int::operator += (value_type by) const
     {
-        const auto r = internal::process_validate<result::integer>::run(connection, "INCRBY %s %s", name.c_str(), std::to_string(by).c_str());
+        const auto r = internal::process_validate<result::integer>::run(connection, "INCRBY", name, by);
              
         return r.message();        
     }
     
     long_int::value_type long_int::operator -= (value_type by) const
     {
-        const auto r = internal::process_validate<result::integer>::run(connection, "DECRBY %s %s", name.c_str(), std::to_string(by).c_str());
+        const auto r = internal::process_validate<result::integer>::run(connection, "DECRBY", name, by);
                 
         return r.message();        
     }
 
+    deferred<result::integer> long_int::add(pipeline& batch, value_type by) const
+    {
+        return internal::queue<result::integer>(batch, "INCRBY", name, by);
+    }
+
+    deferred<result::integer> long_int::subtract(pipeline& batch, value_type by) const
+    {
+        return internal::queue<result::integer>(batch, "DECRBY", name, by);
+    }
+
     bool operator == (const long_int& ulr, const long_int& ull)
     {
         return static_cast<long_int::value_type>(ulr) == static_cast<long_int::value_type>(ull);
@@ -335,18 +543,28 @@ namespace redis
 
     bool rarray::push_back(const string_type& value)
     {
-        const auto r = internal::process_validate<result::integer>::run(connection, "RPUSH %s %b", name.c_str(), value.data(), value.size());
+        const auto r = internal::process_validate<result::integer>::run(connection, "RPUSH", name, value);
                
         return r.message() > 0;        
     }
 
     bool rarray::push_front(const string_type& value)
     {
-        const auto r = internal::process_validate<result::integer>::run(connection, "LPUSH %s %b", name.c_str(), value.data(), value.size());
+        const auto r = internal::process_validate<result::integer>::run(connection, "LPUSH", name, value);
                
         return r.message() > 0;
     }
 
+    deferred<result::integer> rarray::push_back(pipeline& batch, const string_type& value) const
+    {
+        return internal::queue<result::integer>(batch, "RPUSH", name, value);
+    }
+
+    deferred<result::integer> rarray::push_front(pipeline& batch, const string_type& value) const
+    {
+        return internal::queue<result::integer>(batch, "LPUSH", name, value);
+    }
+
     rarray::result_type rarray::operator [] (size_type index) const
     {
         return at(index);
@@ -354,9 +572,9 @@ namespace redis
 
     rarray::result_type rarray::at(size_type at) const
     {
-        const auto r = internal::process_validate<result::array>::run(connection, "GET %s", name.c_str());
+        const auto r = internal::process_validate<result::array>::run(connection, "GET", name);
         
-        const auto st = result::try_into<result::string>(r.operator[](at)).and_then([](const auto& s) -> ::result<std::string, std::string> {
+        const auto st = result::try_into<result::string>(r.view(at)).and_then([](const auto& s) -> ::result<std::string, std::string> {
             return ok(result::to_string(s));
         });
         if (st.is_ok()) {
@@ -370,7 +588,7 @@ namespace redis
 
     rarray::iterator rarray::begin() const
     {
-        auto r = internal::process_validate<result::array>::run(connection, "LRANGE %s 0 -1", name.c_str());
+        auto r = internal::process_validate<result::array>::run(connection, "LRANGE", name, 0, -1);
         
         reply_iterator i(std::move(r));    
         return i;
@@ -383,7 +601,7 @@ namespace redis
 
     rarray::size_type rarray::size() const
     {
-        auto r = internal::process_validate<result::array>::run(connection, "LLEN %s", name.c_str());
+        auto r = internal::process_validate<result::array>::run(connection, "LLEN", name);
         
         return r.size();
     }
@@ -399,7 +617,7 @@ namespace redis
             throw connection_error("trying to use invalid endpoint object to delete value");
         }
 
-        redisCommand(cast(connection), "DEL %s", name.c_str());
+        internal::process<void>::run(connection, "DEL", name);
     }
 
 }   // end of redis namespace
@@ -2,9 +2,18 @@
 
 #include "redis_endpoint.h"
 #include "redis_reply_iterator.h"
+#include "redis_pipeline.h"
+#include "redis_string_iterator.h"
+#include "redis_string_patch.h"
+#include "redis_scan.h"
 #include <string>
+#include <vector>
+#include <optional>
+#include <memory>
 #include <utility>
 #include <algorithm>
+#include <iterator>
+#include <type_traits>
 
 namespace redis
 {
@@ -26,10 +35,20 @@ namespace redis
         std::cout<<"this string length is "<<str.size()<<std::endl; // would print 61
         std::cout<<"sub str for range 4 - 8 is "str.substr()<<std::endl;    // would print ' is ';
         std::cout<<"char at 2 is '"<<str[2]<<"'<<std::endl; // would print i
+        // for large values, read and write it in chunks, see redis_string_stream.h
+        auto found = std::search(str.begin(), str.end(), pattern.begin(), pattern.end());  // only a few round trips
+        const auto chars = str.chars();     // both ends on the same blocks, so we can walk back from the end
+        std::string reversed;
+        std::reverse_copy(chars.begin(), chars.end(), std::back_inserter(reversed));
+        auto state = str.str();
+        auto changed = state; changed[1000] = 'x';
+        str.patch(state, changed);     // only a SETRANGE of the byte that changed
     */
     struct rstring
     {
         typedef std::pair<int, int> range_type;
+        typedef rstring_iterator const_iterator;
+        typedef details::string_blocks::options iteration_options;
         // initiation of a string as thourgh the connection point and the name that we 
         // would use to set values to
         rstring(end_point ep, const std::string& name);
@@ -37,16 +56,23 @@ namespace redis
         // this function would set new value to the string set by ctor
         rstring& operator = (const std::string& value);
 
+        // same as operator = but the command is queued to the pipeline
+        deferred<result::status> assign(pipeline& batch, const std::string& value) const;
+
         // this would append string or set new value if not exists
         rstring& operator +=(const std::string& add_str);
 
         // see above operator +=
         void append(const std::string& add_str);
 
+        // replace the value old (that must be the current value) with now, by only sending the
+        // ranges that changed (see redis_string_patch.h). throws connection_error on failure
+        patch_stats patch(std::string_view old, std::string_view now, const patch_options& opts = {});
+
         // get the stored value of the string - return NULL if nothing there
         std::string str() const;
     
-        // return the length of the string stored
+        // return the length of the string stored - this is not reading the value (STRLEN)
         std::string::size_type size() const;
 
         // return the char at a given index 
@@ -60,6 +86,19 @@ namespace redis
         // remove this entry - note it would not be possible to use this again..
         void erase();
 
+        const std::string& name() const;
+
+        end_point& by() const;
+
+        // iterate over the chars of the value, reading it in blocks (see redis_string_iterator.h).
+        // Each call to begin starts new iteration, and end is a sentinel that matches the end of any of them
+        const_iterator begin() const;
+
+        const_iterator end() const;
+
+        // same as above, where both ends are reading the same blocks
+        rstring_chars chars(const iteration_options& opts = {}) const;
+
     private:
         std::string key_name;
         mutable end_point   connection;
@@ -74,6 +113,8 @@ namespace redis
     // note that since this can access any key in the database, getting all keys to iterate over them - 
     // as in stl map is considered bad practice. For this reason, there is no begin/end and 
     // even the functions size and empty should not be called noramally!
+    // When you do need to go over the keys (cleanups, audits), use scan - it reads the keys in
+    // pages with SCAN, so it is not blocking the server (see redis_scan.h)
 
     /*
     usage:
@@ -84,9 +125,15 @@ namespace redis
     map["hello"] = "world";
     map["foo"] = "bar";
     map.insert("key", "value");
+    std::vector<rmap::value_type> many = {{"a", "1"}, {"b", "2"}};
+    map.insert_range(many.begin(), many.end());     // MSET, in chunks of up to 512 entries
+    auto values = map.find_many({"a", "b", "no such key"});  // MGET - the last one is empty
     std::cout<<"the value of key 'foo' is "<<map.find("foo")<<std::endl;    // would print bar
     map.erase("foo");
     std::cout<<"the value of key 'foo' is "<<map.find("foo")<<std::endl;    // would print nothing
+    for (const auto& entry : map.scan("k*")) {
+        std::cout<<"found key "<<entry.first<<std::endl;
+    }
     */
     struct rmap
     {
@@ -94,6 +141,11 @@ namespace redis
         typedef std::string                         string_type;    // first is payload, second is length
         typedef string_type                         mapped_type;
         typedef std::pair<key_type, mapped_type>    value_type;
+        typedef end_point::milliseconds_t           ttl_type;
+
+        // the number of keys that we are sending in each MSET/MGET (or SET in each write when
+        // there is TTL), so that large batches would not block the server for long
+        static constexpr std::size_t DEFAULT_CHUNK = 512;
 
         explicit rmap(end_point ep);
 
@@ -106,20 +158,89 @@ namespace redis
 
         bool insert(const value_type& new_val) const;
 
+        // queue the insert to the pipeline - the result is available after exec
+        deferred<result::status> insert(pipeline& batch, const key_type& key, const mapped_type& value) const;
+
         // insert a range of elements - note that each of which must be 
-        // type of value_type or convert to it
+        // type of value_type or convert to it. The elements are sent with MSET, encoded straight
+        // from the range. When the end point is a cluster each of them is a SET of its own, since
+        // a single MSET can only have keys of one slot. throws connection_error on failure
         template<typename It>
-        void insert_range(It from, It to)
+        void insert_range(It from, It to, std::size_t chunk = DEFAULT_CHUNK)
         {
-            
-            std::for_each(from, to, [this](const auto& v) {
-                this->insert(v);
-            });
+            using category = typename std::iterator_traits<It>::iterator_category;
+            chunk = std::max<std::size_t>(chunk, 1);
+            range_writer out(connection);
+            if (out.routed()) {
+                for (; from != to; ++from) {
+                    const value_type& entry = *from;
+                    out.batch.encoder().command("SET", entry.first, entry.second);
+                    out.track(chunk);
+                }
+            } else if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+                while (from != to) {
+                    auto last = from;
+                    std::size_t count = 0;
+                    for (; last != to && count < chunk; ++last) {
+                        ++count;
+                    }
+                    auto& encoder = out.batch.encoder();
+                    encoder.begin(1 + count * 2).arg("MSET");
+                    for (; from != last; ++from) {
+                        const value_type& entry = *from;
+                        encoder.arg(entry.first).arg(entry.second);
+                    }
+                    out.track(CHUNKS_PER_WRITE);
+                }
+            } else {
+                // we can only read the range once, so we must keep the entries of a chunk to count them
+                std::vector<value_type> entries;
+                while (from != to) {
+                    entries.clear();
+                    for (; from != to && entries.size() < chunk; ++from) {
+                        entries.emplace_back(*from);
+                    }
+                    auto& encoder = out.batch.encoder();
+                    encoder.begin(1 + entries.size() * 2).arg("MSET");
+                    for (const auto& entry : entries) {
+                        encoder.arg(entry.first).arg(entry.second);
+                    }
+                    out.track(CHUNKS_PER_WRITE);
+                }
+            }
+            out.finish();
+        }
+
+        // same as above, but all the entries would expire after ttl (SET with PX, in one write for each chunk)
+        template<typename It>
+        void insert_range(It from, It to, ttl_type ttl, std::size_t chunk = DEFAULT_CHUNK)
+        {
+            chunk = std::max<std::size_t>(chunk, 1);
+            range_writer out(connection);
+            for (; from != to; ++from) {
+                const value_type& entry = *from;
+                out.batch.encoder().command("SET", entry.first, entry.second, "PX", ttl.count());
+                out.track(chunk);
+            }
+            out.finish();
         }
 
+        // when the end point is a cluster, the keys are grouped by their slot, since a single MSET
+        // can only have keys of one slot. throws connection_error on failure
+        void insert_many(const std::vector<value_type>& entries, std::size_t chunk = DEFAULT_CHUNK) const;
+
+        void insert_many(const std::vector<value_type>& entries, ttl_type ttl, std::size_t chunk = DEFAULT_CHUNK) const;
+
         // same as operator [] - return the value if found, otherwise return NULL
         mapped_type find(const key_type& key) const;
 
+        // queue the lookup to the pipeline - the result is available after exec
+        deferred<result::string> find(pipeline& batch, const key_type& key) const;
+
+        // lookup all the keys with MGET (in chunks) - the values are in the same order as the keys,
+        // and are empty for keys that don't exist. throws connection_error on failure
+        std::vector<std::optional<mapped_type>> find_many(const std::vector<key_type>& keys, std::size_t chunk = DEFAULT_CHUNK) const;
+
         void erase(const key_type& k) const;
 
         // return the size of this map
@@ -128,7 +249,34 @@ namespace redis
         // return true if this is empty
         bool empty() const;
 
+        // iterate over the keys that match the pattern (all if empty), and optionally
+        // only over keys of the given type. The count is a hint for the page size
+        key_scan scan(const std::string& pattern = {}, std::size_t count_hint = 100, const std::string& type = {}) const;
+
+        key_scan scan(const scan_options& opts) const;
+
     private:
+        // the number of chunks that we are sending in each write
+        static constexpr std::size_t CHUNKS_PER_WRITE = 16;
+
+        // sends the commands that insert_range encodes into the pipeline, and checks their replies
+        struct range_writer
+        {
+            explicit range_writer(end_point& ep);
+
+            // is the end point a cluster
+            bool routed();
+
+            // the command that was just encoded is done, send them once we have this many
+            void track(std::size_t per_write);
+
+            // send whatever is left - throws connection_error on failure
+            void finish();
+
+            pipeline batch;
+            std::vector<deferred<void>> replies;
+        };
+
         mutable end_point connection;
     };
 
@@ -172,6 +320,10 @@ namespace redis
     
         value_type operator -= (value_type by) const;   // remove  "by" to the stored value
 
+        deferred<result::integer> add(pipeline& batch, value_type by) const;        // same as += but queued to the pipeline
+
+        deferred<result::integer> subtract(pipeline& batch, value_type by) const;   // same as -= but queued to the pipeline
+
         value_type operator *() const;                  // return the stored value
 
         value_type operator () () const;                   // return the stored value
@@ -234,6 +386,11 @@ namespace redis
         // add new entry ot the array at the front
         bool push_front(const string_type& value);
 
+        // same as above, but queued to the pipeline
+        deferred<result::integer> push_back(pipeline& batch, const string_type& value) const;
+
+        deferred<result::integer> push_front(pipeline& batch, const string_type& value) const;
+
         // get entry from the array basesd on location (index)
         result_type operator [] (size_type at) const; 
 
@@ -51,11 +51,8 @@ multimap_iterator::result_type multimap_iterator::dereference() const
 
     static const auto end = reply_iterator{};
     if (current != end && at(current) % 2 == 0) { // make sure that we can dereference from legal value!
-        reply_iterator tmp(current);
-        const auto st = result::try_into<result::string>(*current).and_then([&tmp](auto&& s) -> ::result<result_type, std::string> {
-           ++tmp;
-            //mapped_type m(tmp->answer(), tmp->size());
-            const auto m = result::try_into<result::string>(*tmp);
+        const auto st = result::try_into<result::string>(*current).and_then([this](auto&& s) -> ::result<result_type, std::string> {
+            const auto m = result::try_into<result::string>(peek(current, 1));
             if (m.is_ok()) {
                 return ok(result_type(result::to_string(s), result::to_string(m.unwrap())));
             }
@@ -130,13 +127,12 @@ rmmap_proxy rmultimap::operator [] (const key_type& at)
 
 void rmultimap::insert(const key_type& key, const value_type& val)
 {
-    redisCommand(cast(endpoint), "HSET %b %b %b", key.data(), key.size(),
-            val.first.data(), val.first.size(), val.second.data(), val.second.size());
+    internal::process<void>::run(endpoint, "HSET", key, val.first, val.second);
 }
 
 void rmultimap::clear(const key_type& key) 
 {
-    redisCommand(cast(endpoint), "DEL %b", key.data(), key.size());
+    internal::process<void>::run(endpoint, "DEL", key);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -159,8 +155,7 @@ std::optional<rmmap_proxy::mapped_type> rmmap_proxy::operator [] (const key_type
 
 bool rmmap_proxy::insert(const value_type& new_entry) const
 {
-    const auto r = internal::process<result::status>::run(*ep, "HMSET %b %b %b", pkey.data(), pkey.size(),
-                                      new_entry.first.data(), new_entry.first.size(), new_entry.second.data(), new_entry.second.size());
+    const auto r = internal::process<result::status>::run(*ep, "HMSET", pkey, new_entry.first, new_entry.second);
     return  r.is_error() ? false : boost::algorithm::iequals(r.unwrap().message(), "ok");
 }
 
@@ -176,9 +171,7 @@ bool rmmap_proxy::empty() const
 
 std::size_t rmmap_proxy::size() const
 {
-    const auto r = internal::process<result::integer>::run(
-        *ep, "HLEN %b", pkey.data(), pkey.size()
-    );
+    const auto r = internal::process<result::integer>::run(*ep, "HLEN", pkey);
     
     if (r.is_ok()) {
         return r.unwrap().message();
@@ -189,9 +182,7 @@ std::size_t rmmap_proxy::size() const
 
 rmmap_proxy::keys_iterator rmmap_proxy::keys_begin()
 {
-    const auto r = internal::process<result::array>::run(
-        *ep, "HKEYS %b", pkey.data(), pkey.size()
-    );
+    const auto r = internal::process<result::array>::run(*ep, "HKEYS", pkey);
     
     if (r.is_ok()) {
         auto a = r.unwrap();
@@ -203,12 +194,7 @@ rmmap_proxy::keys_iterator rmmap_proxy::keys_begin()
 
 rmmap_proxy::const_keys_iterator rmmap_proxy::keys_begin() const
 {
-    const auto r = internal::process<result::array>::run(
-        *ep, "HKEYS %b", pkey.data(), pkey.size()
-    );
-    // auto  r = result::try_into<result::array>(result::any::from(
-    //     (redisReply*)redisCommand(cast(*ep), "HKEYS %b", pkey.data(), pkey.size()))
-    // );
+    const auto r = internal::process<result::array>::run(*ep, "HKEYS", pkey);
     if (r.is_ok()) {
         auto a = r.unwrap();
         return keys_iterator(std::move(a));
@@ -230,9 +216,7 @@ rmmap_proxy::const_keys_iterator rmmap_proxy::keys_end() const
 
 rmmap_proxy::iterator rmmap_proxy::begin() {
    
-    const auto arr = internal::process<result::array>::run(
-        *ep, "HGETALL %b", pkey.data(), pkey.size()
-    );
+    const auto arr = internal::process<result::array>::run(*ep, "HGETALL", pkey);
     if (arr.is_ok()) {
         auto a = arr.unwrap();
         return iterator(std::move(a));
@@ -248,9 +232,7 @@ rmmap_proxy::iterator rmmap_proxy::end()
 
 rmmap_proxy::const_iterator rmmap_proxy::begin() const
 {
-    const auto arr = internal::process<result::array>::run(
-        *ep, "HGETALL %b", pkey.data(), pkey.size()
-    );
+    const auto arr = internal::process<result::array>::run(*ep, "HGETALL", pkey);
     
     if (arr.is_ok()) {
         auto a = arr.unwrap();
@@ -267,12 +249,10 @@ rmmap_proxy::const_iterator rmmap_proxy::end() const
 
 std::optional<std::string> rmmap_proxy::find(const key_type& key) const
 {
-    const auto r = internal::process<result::string>::run(
-        *ep, "HGET %d %d", pkey.data(), pkey.size(), key.data(), key.size()
-    );
+    const auto r = internal::read_through(*ep, "HGET", pkey, key);
     
     if (r.is_ok()) {
-        return result::to_string(r.unwrap());
+        return r.unwrap();
     } else {
         return {};
     }
@@ -280,7 +260,7 @@ std::optional<std::string> rmmap_proxy::find(const key_type& key) const
 
 void rmmap_proxy::erase(const key_type& key)
 {
-    redisCommand(cast(*ep), "HDEL %b %b", pkey.data(), pkey.size(), key.data(), key.size());
+    internal::process<void>::run(*ep, "HDEL", pkey, key);
 }
 
 
@@ -0,0 +1,204 @@
+#include "redis_multiplex_subscriber.h"
+
+namespace redis
+{
+
+using namespace std::string_literals;
+
+namespace
+{
+    auto text(const result::array& from, std::size_t at) -> std::string_view
+    {
+        const auto s = result::try_into<result::string>(from.view(at));
+        return s.is_ok() ? s.unwrap().message() : std::string_view{};
+    }
+
+    auto find(const std::unordered_map<std::string, std::shared_ptr<multiplex_subscriber::handler_t>>& handlers,
+              std::string_view name) -> std::shared_ptr<multiplex_subscriber::handler_t>
+    {
+        const auto i = handlers.find(std::string(name));
+        return i == handlers.end() ? nullptr : i->second;
+    }
+}   // end of local namespace
+
+multiplex_subscriber::multiplex_subscriber(end_point ep) : connection{std::move(ep)}
+{
+    if (!connection) {
+        throw connection_error("trying to create subscriber with invalid redis endpoint object");
+    }
+    // with RESP3 the messages are arriving as push messages
+    buffers(connection).in.on_push([this](const result::array& message) {
+        dispatch(message);
+    });
+}
+
+multiplex_subscriber::~multiplex_subscriber()
+{
+    if (connection) {
+        buffers(connection).in.on_push(nullptr);
+    }
+}
+
+auto multiplex_subscriber::change(const char* command, const std::string& topic) -> result_t
+{
+    // we are holding the lock here - the reading thread is not sending anything so we can
+    // safely write to the socket while it is waiting for messages
+    out.clear();
+    out.command(command, topic);
+    return internal::resp::send(connection, out.data());
+}
+
+auto multiplex_subscriber::subscribe(const std::string& channel, handler_t handler) -> result_t
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const auto [at, fresh] = channels.insert_or_assign(channel, std::make_shared<handler_t>(std::move(handler)));
+    if (!fresh) {
+        return ok(true);
+    }
+    const auto r = change("SUBSCRIBE", channel);
+    if (r.is_error()) {
+        channels.erase(at);
+    }
+    return r;
+}
+
+auto multiplex_subscriber::psubscribe(const std::string& pattern, handler_t handler) -> result_t
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const auto [at, fresh] = patterns.insert_or_assign(pattern, std::make_shared<handler_t>(std::move(handler)));
+    if (!fresh) {
+        return ok(true);
+    }
+    const auto r = change("PSUBSCRIBE", pattern);
+    if (r.is_error()) {
+        patterns.erase(at);
+    }
+    return r;
+}
+
+auto multiplex_subscriber::unsubscribe(const std::string& channel) -> result_t
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (channels.erase(channel) == 0) {
+        return ok(false);
+    }
+    return change("UNSUBSCRIBE", channel);
+}
+
+auto multiplex_subscriber::punsubscribe(const std::string& pattern) -> result_t
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (patterns.erase(pattern) == 0) {
+        return ok(false);
+    }
+    return change("PUNSUBSCRIBE", pattern);
+}
+
+auto multiplex_subscriber::dispatch(const result::array& message) -> bool
+{
+    if (message.empty()) {
+        return false;
+    }
+    // ["message", channel, payload] or ["pmessage", pattern, channel, payload], the
+    // rest are confirmations for subscribe/unsubscribe and pong
+    const auto kind = text(message, 0);
+    std::shared_ptr<handler_t> handler;
+    std::size_t channel = 1;
+    if (kind == "message" && message.size() >= 3) {
+        std::lock_guard<std::mutex> guard(lock);
+        handler = find(channels, text(message, 1));
+    } else if (kind == "pmessage" && message.size() >= 4) {
+        std::lock_guard<std::mutex> guard(lock);
+        handler = find(patterns, text(message, 1));
+        channel = 2;
+    } else {
+        return false;
+    }
+    if (handler) {
+        ++messages;
+        (*handler)(text(message, channel), text(message, channel + 1));
+    } else {
+        ++dropped;      // we just unsubscribed from it
+    }
+    return true;
+}
+
+auto multiplex_subscriber::poll(milliseconds_t timeout) -> ::result<std::size_t, std::string>
+{
+    using clock_type = std::chrono::steady_clock;
+
+    const auto forever = timeout.count() < 0;
+    const auto deadline = clock_type::now() + (forever ? milliseconds_t{0} : timeout);
+    auto& in = buffers(connection).in;
+    std::size_t count = 0;
+    while (!stopped) {
+        const auto r = in.next();
+        if (r.is_error()) {
+            return failed(r.error_value());
+        }
+        if (const auto& reply = r.unwrap(); reply) {
+            if (reply->is_error()) {
+                const auto e = result::try_into<result::error>(*reply).unwrap().message();
+                return failed("redis error: "s + std::string(e.data(), e.size()));
+            }
+            // anything that is not an array is not a message (we are not sending anything else on this connection)
+            if (const auto message = reply->as_array(); message.is_ok() && dispatch(message.unwrap())) {
+                ++count;
+            }
+            continue;
+        }
+        if (count > 0) {
+            return ok(count);   // we are done with what we have so far
+        }
+        auto wait = milliseconds_t{-1};
+        if (!forever) {
+            wait = std::chrono::duration_cast<milliseconds_t>(deadline - clock_type::now());
+            if (wait.count() <= 0) {
+                return ok(count);
+            }
+        }
+        const auto f = internal::resp::fill(connection, wait, wake.handle());
+        if (f.is_error()) {
+            return failed(f.error_value());
+        }
+        if (wake.consume()) {
+            break;      // stop was called
+        }
+        if (!f.unwrap() && !forever && clock_type::now() >= deadline) {
+            return ok(count);
+        }
+    }
+    return ok(count);
+}
+
+auto multiplex_subscriber::run() -> result_t
+{
+    while (!stopped) {
+        if (const auto r = poll(milliseconds_t{-1}); r.is_error()) {
+            stopped = false;
+            return failed(r.error_value());
+        }
+    }
+    stopped = false;
+    return ok(true);
+}
+
+auto multiplex_subscriber::stop() -> void
+{
+    stopped = true;
+    wake.notify();
+}
+
+auto multiplex_subscriber::size() const -> std::size_t
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return channels.size() + patterns.size();
+}
+
+auto multiplex_subscriber::statistics() const -> stats
+{
+    return stats{messages.load(), dropped.load()};
+}
+
+}   // end of namespace redis
+
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include "rediscpp/internal/resp.h"
+#include "rediscpp/internal/wakeup.h"
+#include "result/results.h"
+#include <string>
+#include <string_view>
+#include <functional>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * the subscriber (see redis_channel.h) is using the connection for a single channel,
+ * and so we need a connection and a thread that is blocked on it, for each channel.
+ * The multiplex subscriber is subscribing to any number of channels and patterns over the same
+ * connection, and dispatches each message to the handler of its channel (or the pattern that
+ * it matched). Subscriptions can be added and removed at any time, including from other
+ * threads while the reading thread is waiting for messages.
+ * Note that once we subscribed, the connection can only be used for subscriptions, so
+ * don't use the end point (or its copies) for anything else.
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        multiplex_subscriber subscriptions(connection);
+        subscriptions.subscribe("orders", [](std::string_view channel, std::string_view message) {
+            std::cout<<"got "<<message<<" on "<<channel<<std::endl;
+        });
+        subscriptions.psubscribe("prices.*", [](std::string_view channel, std::string_view message) {
+            // channel is the actual channel that matched the pattern
+        });
+        std::thread reader([&subscriptions]() { subscriptions.run(); });
+        // .. from any thread
+        subscriptions.subscribe("news", news_handler);
+        subscriptions.unsubscribe("orders");
+        subscriptions.stop();       // run would return
+        reader.join();
+    */
+    struct multiplex_subscriber
+    {
+        using result_t = ::result<bool, std::string>;
+        using milliseconds_t = end_point::milliseconds_t;
+        // for pattern subscriptions, the channel is the one that matched the pattern
+        using handler_t = std::function<void(std::string_view channel, std::string_view message)>;
+
+        struct stats
+        {
+            std::uint64_t messages = 0;     // messages that were passed to handlers
+            std::uint64_t dropped = 0;      // messages for channels that we no longer have handler for
+        };
+
+        explicit multiplex_subscriber(end_point ep);
+
+        ~multiplex_subscriber();
+
+        multiplex_subscriber(const multiplex_subscriber&) = delete;
+        multiplex_subscriber& operator = (const multiplex_subscriber&) = delete;
+
+        // if we already have handler for this channel, it is replaced
+        auto subscribe(const std::string& channel, handler_t handler) -> result_t;
+
+        auto psubscribe(const std::string& pattern, handler_t handler) -> result_t;
+
+        auto unsubscribe(const std::string& channel) -> result_t;
+
+        auto punsubscribe(const std::string& pattern) -> result_t;
+
+        // wait up to the timeout for messages and pass them to the handlers. Return the number of
+        // messages that were processed. Only one thread should call this (or run)
+        auto poll(milliseconds_t timeout) -> ::result<std::size_t, std::string>;
+
+        // process messages until stop is called or the connection fails
+        auto run() -> result_t;
+
+        // can be called from any thread
+        auto stop() -> void;
+
+        auto size() const -> std::size_t;   // number of channels and patterns that we are subscribed to
+
+        auto statistics() const -> stats;
+
+    private:
+        using handlers_t = std::unordered_map<std::string, std::shared_ptr<handler_t>>;
+
+        auto change(const char* command, const std::string& topic) -> result_t;
+
+        // return true if this was a message (and not confirmation)
+        auto dispatch(const result::array& message) -> bool;
+
+        end_point connection;
+        mutable std::mutex lock;            // for the handlers and for sending
+        handlers_t channels;
+        handlers_t patterns;
+        internal::resp::writer out;
+        internal::wakeup wake;              // for stop - we are not sending anything to the server
+        std::atomic<bool> stopped{false};
+        std::atomic<std::uint64_t> messages{0};
+        std::atomic<std::uint64_t> dropped{0};
+    };
+}   // end of namespace redis
+
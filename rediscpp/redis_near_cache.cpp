@@ -0,0 +1,150 @@
+#include "redis_near_cache.h"
+#include <algorithm>
+
+namespace redis
+{
+
+namespace
+{
+    // rough estimation of the memory that we are using per key and per field, on top of the strings
+    constexpr std::size_t ENTRY_OVERHEAD = 96;
+    constexpr std::size_t FIELD_OVERHEAD = 48;
+}   // end of local namespace
+
+near_cache::near_cache(options opts) : config{std::move(opts)}
+{
+}
+
+auto near_cache::lookup(const std::string& key) -> entry*
+{
+    const auto i = entries.find(key);
+    if (i == entries.end()) {
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, i->second.order);
+    return &i->second;
+}
+
+auto near_cache::find(const std::string& key) -> std::optional<std::string>
+{
+    if (const auto e = lookup(key); e && e->value) {
+        ++counters.hits;
+        return e->value;
+    }
+    ++counters.misses;
+    return {};
+}
+
+auto near_cache::find(const std::string& key, const std::string& field) -> std::optional<std::string>
+{
+    if (const auto e = lookup(key); e) {
+        if (const auto f = e->fields.find(field); f != e->fields.end()) {
+            ++counters.hits;
+            return f->second;
+        }
+    }
+    ++counters.misses;
+    return {};
+}
+
+auto near_cache::insert(const std::string& key) -> entry&
+{
+    if (const auto e = lookup(key); e) {
+        return *e;
+    }
+    lru.push_front(key);
+    auto& e = entries[key];
+    e.order = lru.begin();
+    e.bytes = ENTRY_OVERHEAD + key.size();
+    counters.bytes += e.bytes;
+    return e;
+}
+
+auto near_cache::store(const std::string& key, std::string value) -> void
+{
+    if (!cacheable(key)) {
+        return;
+    }
+    auto& e = insert(key);
+    const auto old_size = e.bytes;
+    e.bytes -= e.value ? e.value->size() : 0;
+    e.bytes += value.size();
+    e.value = std::move(value);
+    resize(e, old_size);
+}
+
+auto near_cache::store(const std::string& key, const std::string& field, std::string value) -> void
+{
+    if (!cacheable(key)) {
+        return;
+    }
+    auto& e = insert(key);
+    const auto old_size = e.bytes;
+    const auto [at, fresh] = e.fields.try_emplace(field);
+    e.bytes += fresh ? FIELD_OVERHEAD + field.size() : 0;
+    e.bytes = e.bytes - at->second.size() + value.size();
+    at->second = std::move(value);
+    resize(e, old_size);
+}
+
+auto near_cache::resize(entry& e, std::size_t old_size) -> void
+{
+    counters.bytes = counters.bytes - old_size + e.bytes;
+    evict();
+}
+
+auto near_cache::evict() -> void
+{
+    // never drop the one that we just inserted (at the front), even if it is too large by itself
+    while (lru.size() > 1 && (entries.size() > config.max_entries || counters.bytes > config.max_bytes)) {
+        erase(entries.find(lru.back()));
+        ++counters.evictions;
+    }
+}
+
+auto near_cache::erase(std::unordered_map<std::string, entry>::iterator at) -> void
+{
+    counters.bytes -= at->second.bytes;
+    lru.erase(at->second.order);
+    entries.erase(at);
+}
+
+auto near_cache::invalidate(const std::string& key) -> void
+{
+    ++counters.invalidations;
+    if (const auto i = entries.find(key); i != entries.end()) {
+        erase(i);
+    }
+}
+
+auto near_cache::clear() -> void
+{
+    lru.clear();
+    entries.clear();
+    counters.bytes = 0;
+}
+
+auto near_cache::cacheable(const std::string& key) const -> bool
+{
+    if (config.mode == mode_t::DEFAULT || config.prefixes.empty()) {
+        return true;
+    }
+    return std::any_of(config.prefixes.begin(), config.prefixes.end(), [&key](const auto& p) {
+        return key.compare(0, p.size(), p) == 0;
+    });
+}
+
+auto near_cache::statistics() const -> stats
+{
+    auto s = counters;
+    s.entries = entries.size();
+    return s;
+}
+
+auto near_cache::settings() const -> const options&
+{
+    return config;
+}
+
+}   // end of namespace redis
+
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/**
+ * near cache is keeping values that we read from the server in the process memory,
+ * so that reading the same key again would not need a round trip to the server.
+ * To make sure that we are not returning stale values, we are using the server
+ * side support for client side caching (redis 6 and above) - the connection is
+ * switched to RESP3, and the server is sending us invalidation messages over
+ * the same connection once any of the keys that we read was changed.
+ * These messages are processed before we are returning anything from the cache.
+ * see https://redis.io/docs/manual/client-side-caching/
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        near_cache::options opts;
+        opts.max_bytes = 16 * 1024 * 1024;
+        connection.enable_cache(opts);
+        rmap config(connection);
+        auto v = config.find("hot key");    // from the server
+        auto v2 = config.find("hot key");   // from the cache, unless someone changed it
+        std::cout<<"cache hits "<<connection.cache_statistics()->hits<<std::endl;
+        // note that once the cache is enabled, this end point cannot be used to subscribe to channels
+    */
+    struct near_cache
+    {
+        enum class mode_t
+        {
+            DEFAULT,        // the server remembers the keys that we read, and notify only on them
+            BROADCAST       // the server notify on any key that match the prefixes, we don't cache other keys
+        };
+
+        struct options
+        {
+            mode_t mode = mode_t::DEFAULT;
+            std::vector<std::string> prefixes;          // for broadcast mode, empty means all the keys
+            std::size_t max_entries = 10'000;           // number of keys that we are keeping
+            std::size_t max_bytes = 64 * 1024 * 1024;   // approximate size of memory that we are using
+        };
+
+        struct stats
+        {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t invalidations = 0;    // number of keys that the server told us were changed
+            std::uint64_t evictions = 0;        // keys that were dropped to make room for new ones
+            std::size_t entries = 0;
+            std::size_t bytes = 0;
+        };
+
+        explicit near_cache(options opts);
+
+        // for values of strings
+        auto find(const std::string& key) -> std::optional<std::string>;
+
+        // for values inside hashes
+        auto find(const std::string& key, const std::string& field) -> std::optional<std::string>;
+
+        auto store(const std::string& key, std::string value) -> void;
+
+        auto store(const std::string& key, const std::string& field, std::string value) -> void;
+
+        // drop the key and all its fields
+        auto invalidate(const std::string& key) -> void;
+
+        auto clear() -> void;
+
+        // whether we can keep this key - in broadcast mode we only get notification on some of the keys
+        auto cacheable(const std::string& key) const -> bool;
+
+        auto statistics() const -> stats;
+
+        auto settings() const -> const options&;
+
+    private:
+        struct entry
+        {
+            std::list<std::string>::iterator order;
+            std::optional<std::string> value;
+            std::unordered_map<std::string, std::string> fields;
+            std::size_t bytes = 0;
+        };
+
+        auto lookup(const std::string& key) -> entry*;
+
+        auto insert(const std::string& key) -> entry&;
+
+        auto resize(entry& e, std::size_t old_size) -> void;
+
+        auto erase(std::unordered_map<std::string, entry>::iterator at) -> void;
+
+        auto evict() -> void;
+
+        options config;
+        stats counters;
+        std::list<std::string> lru;     // most recently used is at the front
+        std::unordered_map<std::string, entry> entries;
+    };
+}   // end of namespace redis
+
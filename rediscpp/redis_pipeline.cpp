@@ -0,0 +1,138 @@
+#include "redis_pipeline.h"
+#include "rediscpp/internal/router.h"
+
+namespace redis
+{
+
+using namespace std::string_literals;
+
+namespace
+{
+    // redis errors are only failing the command, not the pipeline
+    auto to_reply(const result::any& r) -> ::result<result::any, std::string>
+    {
+        if (r.is_error()) {
+            const auto e = result::try_into<result::error>(r).unwrap().message();
+            return failed("redis error: "s + std::string(e.data(), e.size()));
+        }
+        return ok(r);
+    }
+
+    auto collect(std::vector<std::shared_ptr<details::deferred_state>>& commands,
+                 const internal::router::replies_type& replies) -> pipeline::result_t
+    {
+        std::size_t done = 0;
+        for (std::size_t i = 0; i < commands.size(); ++i) {
+            if (i >= replies.size()) {
+                commands[i]->reply = failed("no reply for pipelined command"s);
+            } else if (replies[i].is_error()) {
+                commands[i]->reply = failed(replies[i].error_value());
+            } else {
+                commands[i]->reply = to_reply(replies[i].unwrap());
+                ++done;
+            }
+        }
+        return ok(done);
+    }
+}   // end of local namespace
+
+pipeline::pipeline(end_point e) : ep{std::move(e)}
+{
+    if (!ep) {
+        throw connection_error("trying to create pipeline with invalid redis endpoint object");
+    }
+}
+
+pipeline::~pipeline()
+{
+    if (!pending.empty() && ep) {
+        exec();
+    }
+}
+
+auto pipeline::append(const std::string_view* args, std::size_t count) -> std::shared_ptr<details::deferred_state>
+{
+    requests.begin(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        requests.arg(args[i]);
+    }
+    return track();
+}
+
+auto pipeline::encoder() -> internal::resp::writer&
+{
+    return requests;
+}
+
+auto pipeline::track() -> std::shared_ptr<details::deferred_state>
+{
+    pending.push_back(std::make_shared<details::deferred_state>());
+    return pending.back();
+}
+
+auto pipeline::discard() -> void
+{
+    for (auto& c : pending) {
+        c->reply = failed("the command was discarded"s);
+    }
+    pending.clear();
+    requests.clear();
+}
+
+auto pipeline::exec() -> result_t
+{
+    if (!ep) {
+        return failed("not connected"s);
+    }
+    auto commands = std::move(pending);
+    pending.clear();
+    if (commands.empty()) {
+        return ok(std::size_t{0});
+    }
+    if (const auto& route = buffers(ep).route; route) {
+        auto replies = route->execute(requests.data(), commands.size());
+        requests.clear();
+        return collect(commands, replies);
+    }
+    const auto sent = internal::resp::send(ep, requests.data());
+    requests.clear();
+    if (sent.is_error()) {
+        for (auto& c : commands) {
+            c->reply = failed(sent.error_value());
+        }
+        return failed(sent.error_value());
+    }
+    std::size_t done = 0;
+    for (auto& c : commands) {
+        const auto reply = internal::resp::receive(ep);
+        if (reply.is_error()) {
+            // the connection is broken, no point in trying to read the rest
+            const auto msg = "failed to read pipelined reply: "s + reply.error_value();
+            for (auto i = done; i < commands.size(); ++i) {
+                commands[i]->reply = failed(msg);
+            }
+            return failed(msg);
+        }
+        c->reply = to_reply(reply.unwrap());
+        ++done;
+    }
+    return ok(done);
+}
+
+auto pipeline::size() const -> std::size_t
+{
+    return pending.size();
+}
+
+auto pipeline::empty() const -> bool
+{
+    return pending.empty();
+}
+
+auto pipeline::connection() -> end_point&
+{
+    return ep;
+}
+
+}   // end of namespace redis
+
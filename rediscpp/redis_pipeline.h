@@ -0,0 +1,186 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include "redis_reply.h"
+#include "rediscpp/internal/resp.h"
+#include "result/results.h"
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <initializer_list>
+#include <type_traits>
+
+/**
+ * normally each operation on the redis proxies is a full round trip to the server -
+ * we are sending the command and then wait for the reply. With the pipeline we are
+ * only encoding the commands into a buffer, and they are all sent to the server in one write on exec.
+ * Then we are reading all the replies in the order the commands were queued. Each command
+ * that is added to the pipeline returns a deferred object that would hold the reply
+ * once exec was called.
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        pipeline batch(connection);
+        rmap map(connection);
+        long_int counter(connection, "my counter");
+        auto i = map.insert(batch, "foo", "bar");
+        auto c = counter.add(batch, 10);
+        auto f = map.find(batch, "hello");
+        batch.exec();       // only now we are talking to the server
+        if (c.get().is_ok()) {
+            std::cout<<"the counter is now "<<c.get().unwrap().message()<<std::endl;
+        }
+        // note that the commands are only sent on exec, so until then the end point can
+        // still be used for other (none pipelined) commands
+    */
+    namespace details
+    {
+        // this holds the reply for a single pipelined command
+        struct deferred_state
+        {
+            std::optional<::result<result::any, std::string>> reply;
+        };
+    }   // end of namespace details
+
+    // the result of a command that was queued to pipeline. This would only hold
+    // a value after the pipeline was executed
+    template<typename T>
+    struct deferred
+    {
+        using value_type = T;
+        using result_type = ::result<T, std::string>;
+
+        deferred() = default;
+
+        explicit deferred(std::shared_ptr<details::deferred_state> s) : state{std::move(s)} {
+        }
+
+        // true once the pipeline that this belongs to was executed
+        auto ready() const -> bool {
+            return state && state->reply.has_value();
+        }
+
+        // return the reply or an error if the command failed or the pipeline was not executed yet
+        auto get() const -> result_type {
+            using namespace std::string_literals;
+
+            if (!ready()) {
+                return failed("pipelined command was not executed yet"s);
+            }
+            return state->reply->and_then([](auto&& r) -> result_type {
+                return result::try_into<T>(r);
+            });
+        }
+
+        // same as above, but throws connection_error on error
+        auto value() const -> T {
+            const auto r = get();
+            if (r.is_error()) {
+                throw connection_error(r.error_value());
+            }
+            return r.unwrap();
+        }
+
+    private:
+        std::shared_ptr<details::deferred_state> state;
+    };
+
+    // for commands that we only care whether they were successful
+    template<>
+    struct deferred<void>
+    {
+        using value_type = void;
+        using result_type = ::result<bool, std::string>;
+
+        deferred() = default;
+
+        explicit deferred(std::shared_ptr<details::deferred_state> s) : state{std::move(s)} {
+        }
+
+        auto ready() const -> bool {
+            return state && state->reply.has_value();
+        }
+
+        auto get() const -> result_type {
+            using namespace std::string_literals;
+
+            if (!ready()) {
+                return failed("pipelined command was not executed yet"s);
+            }
+            if (state->reply->is_error()) {
+                return failed(state->reply->error_value());
+            }
+            return ok(true);
+        }
+
+        auto value() const -> void {
+            const auto r = get();
+            if (r.is_error()) {
+                throw connection_error(r.error_value());
+            }
+        }
+
+    private:
+        std::shared_ptr<details::deferred_state> state;
+    };
+
+    struct pipeline
+    {
+        using result_t = ::result<std::size_t, std::string>;
+        using arguments_t = std::initializer_list<std::string_view>;
+
+        explicit pipeline(end_point ep);
+
+        // if there are still commands that were not executed, they would be executed on exit
+        ~pipeline();
+
+        pipeline(const pipeline&) = delete;
+        pipeline& operator = (const pipeline&) = delete;
+
+        // queue a command - the arguments are the command name followed by its arguments
+        // for example: batch.command<result::integer>({"INCRBY", "my counter", "10"});
+        template<typename T>
+        auto command(arguments_t args) -> deferred<T> {
+            return deferred<T>{append(args.begin(), args.size())};
+        }
+
+        template<typename T>
+        auto command(const std::vector<std::string_view>& args) -> deferred<T> {
+            return deferred<T>{append(args.data(), args.size())};
+        }
+
+        // send all the queued commands in one write and read all the replies. Return
+        // the number of commands that were executed. Note that a command that failed
+        // in the server would not fail this, only its deferred value
+        auto exec() -> result_t;
+
+        // drop the commands that are waiting for exec, their deferred values would fail
+        auto discard() -> void;
+
+        // the number of commands that are waiting for exec
+        auto size() const -> std::size_t;
+
+        auto empty() const -> bool;
+
+        auto connection() -> end_point&;
+
+        // this is for internal use - encode the command directly into the pipeline buffer
+        // and then call track to get the place where its reply would be stored on exec
+        auto encoder() -> internal::resp::writer&;
+
+        auto track() -> std::shared_ptr<details::deferred_state>;
+
+    private:
+        auto append(const std::string_view* args, std::size_t count) -> std::shared_ptr<details::deferred_state>;
+
+        end_point ep;
+        internal::resp::writer requests;
+        std::vector<std::shared_ptr<details::deferred_state>> pending;
+    };
+}   // end of namespace redis
+
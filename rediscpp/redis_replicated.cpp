@@ -0,0 +1,211 @@
+#include "redis_replicated.h"
+#include "rediscpp/internal/resp.h"
+#include "rediscpp/internal/router.h"
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <iterator>
+
+namespace redis
+{
+
+using namespace std::string_literals;
+
+namespace
+{
+    using clock_type = std::chrono::steady_clock;
+
+    constexpr double LATENCY_WEIGHT = 0.2;      // how much the last read is changing the average
+    constexpr std::uint64_t EXPLORE_EVERY = 16; // with lowest latency, every so many reads we are trying other replica
+
+    // the commands that are not changing anything, so a replica can answer them
+    auto read_only(std::string_view command) -> bool {
+        static constexpr std::string_view commands[] = {
+            "DBSIZE", "EXISTS", "GET", "GETRANGE", "HEXISTS", "HGET", "HGETALL", "HKEYS", "HLEN", "HMGET",
+            "HSCAN", "HSTRLEN", "HVALS", "KEYS", "LINDEX", "LLEN", "LRANGE", "MGET", "PTTL", "RANDOMKEY",
+            "SCAN", "SCARD", "SISMEMBER", "SMEMBERS", "SSCAN", "STRLEN", "TTL", "TYPE", "XLEN", "XRANGE",
+            "XREVRANGE", "ZCARD", "ZRANGE", "ZRANK", "ZSCAN", "ZSCORE"
+        };
+        return std::any_of(std::begin(commands), std::end(commands), [command](auto c) {
+            return boost::algorithm::iequals(c, command);
+        });
+    }
+
+    auto open(end_point& ep, const replicated_end_point::node_t& node, const end_point::timeout_t& to) -> end_point::result_t {
+        if (to.sec().count() == 0 && to.milliseconds().count() == 0) {
+            return ep.open(node.host, node.port);
+        }
+        return ep.open(node.host, to, node.port);
+    }
+}   // end of local namespace
+
+namespace details
+{
+    struct replica_router : internal::router
+    {
+        struct node
+        {
+            replicated_end_point::node_t address;
+            end_point connection;
+            double latency = 0;                 // average round trip in microseconds, 0 until we measured it
+            clock_type::time_point down_until;  // if it failed, don't use it before this
+        };
+
+        replica_router(replicated_end_point::node_t primary, std::vector<replicated_end_point::node_t> replicas,
+                replicated_end_point::options opts) : config{std::move(opts)} {
+            servers.push_back(node{std::move(primary), {}, 0, {}});
+            for (auto& r : replicas) {
+                servers.push_back(node{std::move(r), {}, 0, {}});
+            }
+        }
+
+        auto execute(std::string_view requests, std::size_t count) -> replies_type override;
+
+        // the replica for the next read, or the primary (0) if none is available
+        auto choose() -> std::size_t;
+
+        auto connect(std::size_t at) -> end_point*;
+
+        auto run(std::size_t at, std::string_view requests, std::size_t count, replies_type& replies) -> bool;
+
+        replicated_end_point::options config;
+        std::vector<node> servers;              // the first one is the primary
+        clock_type::time_point reads_from_primary_until;
+        std::uint64_t reads = 0;
+        replicated_end_point::stats counters;
+    };
+
+    auto replica_router::connect(std::size_t at) -> end_point*
+    {
+        auto& n = servers[at];
+        if (!n.connection && open(n.connection, n.address, config.timeout).is_error()) {
+            return nullptr;
+        }
+        return &n.connection;
+    }
+
+    auto replica_router::choose() -> std::size_t
+    {
+        const auto now = clock_type::now();
+        if (servers.size() < 2 || now < reads_from_primary_until) {
+            return 0;
+        }
+        const auto replicas = servers.size() - 1;
+        const auto available = [this, now](std::size_t at) {
+            return servers[at].down_until <= now;
+        };
+        const auto next = reads++;
+        if (config.policy == replicated_end_point::policy_t::LOWEST_LATENCY && next % EXPLORE_EVERY != 0) {
+            std::size_t best = 0;
+            for (std::size_t i = 1; i < servers.size(); ++i) {
+                if (available(i) && (best == 0 || servers[i].latency < servers[best].latency)) {
+                    best = i;
+                }
+            }
+            return best;
+        }
+        // round robin - this is also how we get new measurements for the replicas that are not the fastest
+        for (std::size_t i = 0; i < replicas; ++i) {
+            const auto at = 1 + (next + i) % replicas;
+            if (available(at)) {
+                return at;
+            }
+        }
+        return 0;
+    }
+
+    auto replica_router::run(std::size_t at, std::string_view requests, std::size_t count, replies_type& replies) -> bool
+    {
+        const auto start = clock_type::now();
+        const auto ep = connect(at);
+        if (!ep) {
+            for (auto& r : replies) {
+                r = failed("failed to connect to " + servers[at].address.host + ":" + std::to_string(servers[at].address.port));
+            }
+            return false;
+        }
+        if (const auto e = Error(internal::resp::send(*ep, requests)); e) {
+            ep->close_it();
+            for (auto& r : replies) {
+                r = failed(e.value());
+            }
+            return false;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            replies[i] = internal::resp::receive(*ep);
+            if (replies[i].is_error()) {
+                ep->close_it();
+                for (auto j = i + 1; j < count; ++j) {
+                    replies[j] = failed(replies[i].error_value());
+                }
+                return false;
+            }
+        }
+        const auto took = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - start).count());
+        auto& latency = servers[at].latency;
+        latency = latency <= 0 ? took : latency + LATENCY_WEIGHT * (took - latency);
+        return true;
+    }
+
+    auto replica_router::execute(std::string_view requests, std::size_t count) -> replies_type
+    {
+        replies_type replies(count, reply_type{failed("invalid command"s)});
+        // the whole batch goes to the same server, so that the commands are executed in the
+        // order they were sent - if there is any write in it, it must go to the primary
+        bool writes = false;
+        auto data = requests;
+        for (std::size_t i = 0; i < count && !writes; ++i) {
+            const auto r = internal::resp::next_request(data);
+            writes = !r || !read_only(r->name);
+        }
+        if (writes) {
+            ++counters.writes;
+            if (config.read_your_writes.count() > 0) {
+                reads_from_primary_until = clock_type::now() + config.read_your_writes;
+            }
+            run(0, requests, count, replies);
+            return replies;
+        }
+        const auto at = choose();
+        if (at != 0) {
+            if (run(at, requests, count, replies)) {
+                ++counters.replica_reads;
+                return replies;
+            }
+            // the replica is not working, so we would not use it for a while, and this time read from the primary
+            ++counters.replica_failures;
+            servers[at].down_until = clock_type::now() + config.retry_after;
+        }
+        ++counters.primary_reads;
+        run(0, requests, count, replies);
+        return replies;
+    }
+}   // end of namespace details
+
+replicated_end_point::replicated_end_point(node_t primary, std::vector<node_t> replicas, options opts) :
+    router{std::make_shared<details::replica_router>(primary, std::move(replicas), opts)}
+{
+    // the front is sharing the connection of the router to the primary
+    auto& connection = router->servers.front().connection;
+    if (const auto e = Error(open(connection, primary, opts.timeout)); e) {
+        throw connection_error(e.value());
+    }
+    front = routed(connection, router);
+}
+
+replicated_end_point::replicated_end_point(node_t primary, std::vector<node_t> replicas) :
+    replicated_end_point(std::move(primary), std::move(replicas), options{})
+{
+}
+
+auto replicated_end_point::get() -> end_point&
+{
+    return front;
+}
+
+auto replicated_end_point::statistics() const -> stats
+{
+    return router->counters;
+}
+
+}   // end of namespace redis
+
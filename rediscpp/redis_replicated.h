@@ -0,0 +1,84 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include "result/results.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * with redis replication we have one primary server that gets all the writes, and
+ * replicas that are getting a copy of the data from it. The replicated end point is sending
+ * the commands that are only reading to the replicas, and the rest to the primary, so
+ * the read load is spread between the servers without changing the code that is using the end point.
+ * Since the replicas are updated asynchronously, reading from a replica right after a write may
+ * return the old value. To avoid this, you can set a window after each write, in which the reads
+ * are still sent to the primary.
+ * see https://redis.io/docs/management/replication/
+ **/
+
+namespace redis
+{
+    /* usage:
+        replicated_end_point::options opts;
+        opts.policy = replicated_end_point::policy_t::LOWEST_LATENCY;
+        opts.read_your_writes = std::chrono::milliseconds{100};
+        replicated_end_point servers({"primary", 6379}, {{"replica1", 6379}, {"replica2", 6379}}, opts);
+        rmap map(servers.get());
+        map.insert("foo", "bar");       // to the primary
+        auto v = map.find("foo");       // for the next 100 ms from the primary, then from the replicas
+    */
+    namespace details
+    {
+        struct replica_router;
+    }   // end of namespace details
+
+    struct replicated_end_point
+    {
+        using milliseconds_t = end_point::milliseconds_t;
+
+        enum class policy_t
+        {
+            ROUND_ROBIN,        // each read goes to the next replica
+            LOWEST_LATENCY      // reads goes to the replica that answered the fastest lately
+        };
+
+        struct node_t
+        {
+            std::string host;
+            std::uint16_t port = end_point::DEFAULT_PORT;
+        };
+
+        struct options
+        {
+            policy_t policy = policy_t::ROUND_ROBIN;
+            milliseconds_t read_your_writes = milliseconds_t{0};    // after a write, read from the primary for this long
+            milliseconds_t retry_after = std::chrono::seconds{1};   // don't use a replica that failed for this long
+            end_point::timeout_t timeout = {};
+        };
+
+        struct stats
+        {
+            std::uint64_t writes = 0;
+            std::uint64_t primary_reads = 0;    // reads that were sent to the primary
+            std::uint64_t replica_reads = 0;
+            std::uint64_t replica_failures = 0;
+        };
+
+        replicated_end_point(node_t primary, std::vector<node_t> replicas);
+
+        replicated_end_point(node_t primary, std::vector<node_t> replicas, options opts);
+
+        // use this end point with any of the other classes - rmap, rstring, pipeline ..
+        auto get() -> end_point&;
+
+        auto statistics() const -> stats;
+
+    private:
+        end_point front;
+        std::shared_ptr<details::replica_router> router;
+    };
+}   // end of namespace redis
+
@@ -42,7 +42,12 @@ lowlevel_access::lowlevel_access(internals* from, int cond) :
     panic_if(get(), cond);
 }
 
-auto lowlevel_access::access() const -> internals {
+lowlevel_access::lowlevel_access(handle_type from, int cond) :
+    handler(std::move(from)) {
+    panic_if(get(), cond);
+}
+
+auto lowlevel_access::access() const -> internals& {
     assert(get());
     return *get();
 }
@@ -59,27 +64,52 @@ auto array::empty() const -> bool {
 
 auto array::operator[] (std::size_t at) const -> any {
     assert(at < size());
-    return any::from(access().element[at]);
+    // the element is owned by this array, and so it is sharing the ownership with it
+    return any::from(handle_type(handle(), access().element[at]));
+}
+
+auto array::view(std::size_t at) const -> any {
+    assert(at < size());
+    // aliasing an empty handle - this is only a pointer, there is no ownership here
+    return any::from(handle_type(handle_type{}, access().element[at]));
 }
 
 status::status(base_t::internals* f) : base_t(f, REDIS_REPLY_STATUS) {
 }
 
+status::status(base_t::handle_type from) : base_t{std::move(from), REDIS_REPLY_STATUS} {
+}
+
 string::string(base_t::internals* from) : base_t{from, REDIS_REPLY_STRING} {
 }
 
+string::string(base_t::handle_type from) : base_t{std::move(from), REDIS_REPLY_STRING} {
+}
+
 array::array(base_t::internals* from) : base_t{from, REDIS_REPLY_ARRAY} {
 }
 
+array::array(base_t::handle_type from) : base_t{std::move(from), REDIS_REPLY_ARRAY} {
+}
+
 null::null(base_t::internals* from) : base_t{from, REDIS_REPLY_NIL} {
 }
 
+null::null(base_t::handle_type from) : base_t{std::move(from), REDIS_REPLY_NIL} {
+}
+
 error::error(base_t::internals* from) : base_t{from, REDIS_REPLY_ERROR} {
 }
 
+error::error(base_t::handle_type from) : base_t{std::move(from), REDIS_REPLY_ERROR} {
+}
+
 integer::integer(base_t::internals* from) : base_t{from, REDIS_REPLY_INTEGER} {
 }
 
+integer::integer(base_t::handle_type from) : base_t{std::move(from), REDIS_REPLY_INTEGER} {
+}
+
 auto status::message() const -> std::string_view {
     return {access().str, access().len};
 }
@@ -128,10 +158,33 @@ auto any::from(details::lowlevel_access::internals* input) -> any {
     }
 }
 
+auto any::from(details::lowlevel_access::handle_type input) -> any {
+    if (!input) {
+        return any{};
+    }
+
+    switch (input->type) {
+        case REDIS_REPLY_ARRAY:
+            return any{array{std::move(input)}};
+        case REDIS_REPLY_ERROR:
+            return any{error{std::move(input)}};
+        case REDIS_REPLY_INTEGER:
+            return any{integer{std::move(input)}};
+        case REDIS_REPLY_NIL:
+            return any{null{std::move(input)}};
+        case REDIS_REPLY_STATUS:
+            return any{status{std::move(input)}};
+        case REDIS_REPLY_STRING:
+            return any{string{std::move(input)}};
+        default:
+            return any{};
+    }
+}
+
 auto to_string(const any& a) -> std::string {
     using namespace std::string_literals;
 
-    if (a.as_array()) {
+    if (a.is_array()) {
         return "array type"s;
     }
     if (a.is_error()) {
@@ -19,16 +19,24 @@ namespace result {
     {
         struct lowlevel_access {
             using internals = const redisReply;
+            using handle_type = std::shared_ptr<internals>;
         protected:
             explicit lowlevel_access(internals*, int);
+            // the reply is already owned by the handle - this is used for replies that are not
+            // allocated by hiredis, and for elements of array, that are owned by the array
+            lowlevel_access(handle_type, int);
             auto get() const -> const internals* {
                 return handler.get();
             }
 
-            auto access() const -> internals;
+            auto handle() const -> const handle_type& {
+                return handler;
+            }
+
+            auto access() const -> internals&;
         private:
             static auto free(lowlevel_access me) -> void;
-            using internal_handler = std::shared_ptr<internals>;
+            using internal_handler = handle_type;
 
             internal_handler handler;
         };
@@ -43,16 +51,23 @@ namespace result {
         using base_t = details::lowlevel_access;
 
         explicit array(base_t::internals*);
+        explicit array(base_t::handle_type);
 
         auto empty() const -> bool;
         auto size() const -> std::size_t;
         auto operator [] (std::size_t at) const -> any;
+
+        // same as above, only that the element is not sharing the ownership of the
+        // array, so it is only valid as long as the array is alive. This is cheaper
+        // since it is not touching the reference count (used by the iterators)
+        auto view(std::size_t at) const -> any;
     };
 
     struct status : details::lowlevel_access  {
         using base_t = details::lowlevel_access;
 
         explicit status(base_t::internals*);
+        explicit status(base_t::handle_type);
 
         auto message() const -> std::string_view;
     };
@@ -61,6 +76,7 @@ namespace result {
         using base_t = details::lowlevel_access;
 
         explicit error(base_t::internals*);
+        explicit error(base_t::handle_type);
         auto message() const -> std::string_view;
     };
 
@@ -68,6 +84,7 @@ namespace result {
         using base_t = details::lowlevel_access;
 
         explicit string(base_t::internals* from);
+        explicit string(base_t::handle_type from);
 
         auto message() const -> std::string_view;
 
@@ -84,12 +101,14 @@ namespace result {
         using base_t = details::lowlevel_access;
 
         explicit null(base_t::internals*);
+        explicit null(base_t::handle_type);
     };
 
     struct integer : details::lowlevel_access {
         using base_t = details::lowlevel_access;
 
         explicit integer(base_t::internals*);
+        explicit integer(base_t::handle_type);
 
         auto message() const -> std::int64_t;
     };
@@ -109,6 +128,9 @@ namespace result {
 
         static auto from(details::lowlevel_access::internals* input) -> any;
 
+        // create from a reply that is already owned - see lowlevel_access
+        static auto from(details::lowlevel_access::handle_type input) -> any;
+
         constexpr auto is_int() const -> bool {
             return std::holds_alternative<integer>(internal);
         }
@@ -232,11 +254,17 @@ namespace result {
         return from.as_status();
     }
 
-    template<>
+    template<> inline
     auto try_into<array>(const any& from) -> ::result<array, std::string> {
         return from.as_array();
     }
 
+    // for replies that can be of more than one type
+    template<> inline
+    auto try_into<any>(const any& from) -> ::result<any, std::string> {
+        return ok(from);
+    }
+
     auto operator << (std::ostream& os, const any& a) -> std::ostream&;
 }   // end of namespace result
 }   // end of namespace redis
@@ -58,8 +58,14 @@ bool reply_iterator::equal(reply_iterator const& other) const
 
 result::any reply_iterator::dereference() const
 {
-    if (index != invalid_index) {
-        return current.value()[index];
+    return peek(*this, 0);
+}
+
+result::any peek(const reply_iterator& i, reply_iterator::difference_type offset)
+{
+    const auto at = i.index + offset;
+    if (i.index != invalid_index && i.current && at >= 0 && at < (reply_iterator::difference_type)i.current->size()) {
+        return i.current->view(static_cast<std::size_t>(at));
     } else {
         static const result::any error {};
         return error;
@@ -10,7 +10,9 @@ namespace redis
     // use this to iterate over the messages got from the server in case this is 
     // array reply, otherwise this would not work..
     // the usage for this would work with redis array and multi maps and the interface and usage 
-    // is the same as normal stl iterators
+    // is the same as normal stl iterators.
+    // Note that the values that we are returning are pointing into the reply that the iterator
+    // is holding, so they are only valid as long as there is an iterator to this reply
     struct reply_iterator : public boost::iterator_facade<reply_iterator, result::array, 
                                                           boost::random_access_traversal_tag,
                                                           result::any
@@ -23,6 +25,9 @@ namespace redis
             return i.index;
         }
 
+        // the element at the given offset from the iterator position, without moving the iterator
+        friend result::any peek(const reply_iterator& i, difference_type offset);
+
     private:
         friend class boost::iterator_core_access;
         void increment();
@@ -0,0 +1,198 @@
+#include "redis_scan.h"
+#include "redis_pipeline.h"
+#include "rediscpp/internal/commands.h"
+#include <vector>
+
+namespace redis
+{
+
+namespace details
+{
+    struct key_scanner
+    {
+        using value_type = std::pair<std::string, std::string>;
+
+        key_scanner(end_point ep, scan_options opts);
+
+        auto current() const -> const value_type&;
+
+        auto next() -> void;
+
+        auto done() const -> bool;
+
+    private:
+        // read until we have the next page, or there is nothing more to read
+        auto fetch() -> void;
+
+        // the values of the keys that we have in ahead
+        auto values(pipeline& batch) -> std::vector<deferred<result::any>>;
+
+        end_point connection;
+        scan_options config;
+        std::string cursor = "0";
+        bool last = false;                  // the server told us that there are no more pages
+        std::vector<std::string> ahead;     // keys that we still need to read their values
+        std::vector<value_type> page;
+        std::size_t position = 0;
+    };
+
+    key_scanner::key_scanner(end_point ep, scan_options opts) : connection{std::move(ep)}, config{std::move(opts)}
+    {
+        fetch();
+    }
+
+    auto key_scanner::current() const -> const value_type&
+    {
+        return page[position];
+    }
+
+    auto key_scanner::next() -> void
+    {
+        if (++position >= page.size()) {
+            fetch();
+        }
+    }
+
+    auto key_scanner::done() const -> bool
+    {
+        return position >= page.size();
+    }
+
+    auto key_scanner::values(pipeline& batch) -> std::vector<deferred<result::any>>
+    {
+        // in cluster the keys of one MGET must all be in the same slot, so we send one MGET
+        // for each slot, and reorder the keys to match the order of the values in the replies
+        const auto groups = internal::group(connection, ahead.size(), ahead.size(), [this](auto i) -> const std::string& {
+            return ahead[i];
+        });
+        std::vector<std::string> ordered;
+        ordered.reserve(ahead.size());
+        std::vector<deferred<result::any>> replies;
+        replies.reserve(groups.size());
+        for (const auto& g : groups) {
+            auto& out = batch.encoder();
+            out.begin(1 + g.size()).arg("MGET");
+            for (const auto i : g) {
+                out.arg(ahead[i]);
+                ordered.push_back(std::move(ahead[i]));
+            }
+            replies.emplace_back(batch.track());
+        }
+        ahead = std::move(ordered);
+        return replies;
+    }
+
+    auto key_scanner::fetch() -> void
+    {
+        const auto text = [](const result::any& from) -> std::string {
+            const auto s = from.as_string();
+            return s.is_ok() ? result::to_string(s.unwrap()) : std::string{};
+        };
+
+        page.clear();
+        position = 0;
+        while (page.empty() && !(last && ahead.empty())) {
+            pipeline batch(connection);
+            // the values of the keys from the last page are read in the same write as the next page
+            const auto found = config.values && !ahead.empty() ? values(batch) : std::vector<deferred<result::any>>{};
+            deferred<result::any> keys;
+            if (!last) {
+                auto& out = batch.encoder();
+                out.begin(4 + (config.pattern.empty() ? 0 : 2) + (config.type.empty() ? 0 : 2)).arg("SCAN").arg(cursor);
+                if (!config.pattern.empty()) {
+                    out.arg("MATCH").arg(config.pattern);
+                }
+                out.arg("COUNT").arg(config.count);
+                if (!config.type.empty()) {
+                    out.arg("TYPE").arg(config.type);
+                }
+                keys = deferred<result::any>{batch.track()};
+            }
+            if (const auto e = Error(batch.exec()); e) {
+                throw connection_error("failed to scan: " + e.value());
+            }
+
+            if (!found.empty()) {
+                page.reserve(ahead.size());
+                for (const auto& r : found) {
+                    const auto v = r.get();
+                    if (v.is_error()) {
+                        throw connection_error("failed to read values: " + v.error_value());
+                    }
+                    if (const auto a = v.unwrap().as_array(); a.is_ok()) {
+                        for (std::size_t i = 0; i < a.unwrap().size() && page.size() < ahead.size(); ++i) {
+                            page.emplace_back(std::move(ahead[page.size()]), text(a.unwrap().view(i)));
+                        }
+                    }
+                }
+                ahead.clear();
+            }
+            if (last) {
+                continue;
+            }
+            // [cursor, [key, ..]]
+            const auto r = keys.get();
+            if (r.is_error()) {
+                throw connection_error("failed to scan: " + r.error_value());
+            }
+            const auto reply = r.unwrap().as_array();
+            if (reply.is_error() || reply.unwrap().size() < 2) {
+                throw connection_error("invalid reply for SCAN");
+            }
+            cursor = text(reply.unwrap().view(0));
+            last = cursor == "0" || cursor.empty();
+            if (const auto k = reply.unwrap().view(1).as_array(); k.is_ok()) {
+                for (std::size_t i = 0; i < k.unwrap().size(); ++i) {
+                    if (config.values) {
+                        ahead.push_back(text(k.unwrap().view(i)));
+                    } else {
+                        page.emplace_back(text(k.unwrap().view(i)), std::string{});
+                    }
+                }
+            }
+        }
+    }
+}   // end of namespace details
+
+scan_iterator::scan_iterator(std::shared_ptr<details::key_scanner> from) : scanner{std::move(from)}
+{
+}
+
+void scan_iterator::increment()
+{
+    scanner->next();
+}
+
+bool scan_iterator::equal(const scan_iterator& other) const
+{
+    return at_end() ? other.at_end() : scanner == other.scanner;
+}
+
+scan_iterator::reference scan_iterator::dereference() const
+{
+    return scanner->current();
+}
+
+auto scan_iterator::at_end() const -> bool
+{
+    return !scanner || scanner->done();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+key_scan::key_scan(end_point ep, scan_options opts) : connection{std::move(ep)}, config{std::move(opts)}
+{
+}
+
+auto key_scan::begin() const -> iterator
+{
+    return iterator{std::make_shared<details::key_scanner>(connection, config)};
+}
+
+auto key_scan::end() const -> iterator
+{
+    return iterator{};
+}
+
+}   // end of namespace redis
+
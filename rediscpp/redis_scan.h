@@ -0,0 +1,92 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include <boost/iterator/iterator_facade.hpp>
+#include <string>
+#include <utility>
+#include <memory>
+#include <cstddef>
+
+/**
+ * Iterate over the keys in the database with SCAN. Unlike KEYS this is not blocking the server,
+ * since each call only returns a page of keys, and we only keep one page (or two when reading
+ * the values) in memory, regardless of the number of keys in the database.
+ * When we are asked to read the values, we are reading them with MGET, and in the same write
+ * we are asking for the next page of keys, so we only have one round trip per page.
+ * Note that with SCAN a key that exists for the whole iteration is returned at least once,
+ * but it may be returned more than once, and keys that were added or removed while we are
+ * iterating may or may not be returned.
+ * On cluster end point the scan is sent to one of the servers, to scan all of them, use
+ * cluster_end_point::connect for each of the nodes.
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        rmap map(connection);
+        for (const auto& [key, value] : map.scan("session:*")) {
+            // value is empty, since we did not ask for the values
+        }
+        scan_options opts;
+        opts.pattern = "cache:*";
+        opts.values = true;
+        for (const auto& [key, value] : map.scan(opts)) {
+            std::cout<<key<<" = "<<value<<std::endl;
+        }
+    */
+    struct scan_options
+    {
+        std::string pattern;        // MATCH - only keys that matches this pattern, empty for all
+        std::size_t count = 100;    // COUNT - a hint for the number of keys in each page
+        std::string type;           // TYPE - only keys of this type ("string", "hash" ..), empty for all
+        bool values = false;        // read the values as well (empty for keys that are not strings)
+    };
+
+    namespace details
+    {
+        struct key_scanner;
+    }   // end of namespace details
+
+    // the iterators are single pass - all the copies of an iterator are sharing the same position
+    struct scan_iterator : public boost::iterator_facade<scan_iterator,
+                                                         const std::pair<std::string, std::string>,
+                                                         boost::single_pass_traversal_tag
+                           >
+    {
+        scan_iterator() = default;  // this is the end
+
+        explicit scan_iterator(std::shared_ptr<details::key_scanner> from);
+
+    private:
+        friend class boost::iterator_core_access;
+
+        void increment();
+
+        bool equal(const scan_iterator& other) const;
+
+        reference dereference() const;
+
+        auto at_end() const -> bool;
+
+        std::shared_ptr<details::key_scanner> scanner;
+    };
+
+    struct key_scan
+    {
+        using iterator = scan_iterator;
+        using const_iterator = scan_iterator;
+
+        key_scan(end_point ep, scan_options opts);
+
+        // each call is starting a new scan. throws connection_error if we failed to read
+        auto begin() const -> iterator;
+
+        auto end() const -> iterator;
+
+    private:
+        end_point connection;
+        scan_options config;
+    };
+}   // end of namespace redis
+
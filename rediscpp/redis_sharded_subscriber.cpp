@@ -0,0 +1,328 @@
+#include "redis_sharded_subscriber.h"
+#include "rediscpp/internal/pubsub.h"
+#include <hiredis/hiredis.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+
+namespace redis
+{
+
+using namespace std::string_literals;
+
+namespace
+{
+    using clock_type = std::chrono::steady_clock;
+
+    // when we failed to move a channel to its new owner, wait this long before trying again
+    constexpr auto RETRY_AFTER = std::chrono::milliseconds{500};
+}   // end of local namespace
+
+sharded_subscriber::sharded_subscriber(cluster_end_point& c) : cluster{c}
+{
+}
+
+sharded_subscriber::~sharded_subscriber()
+{
+    stop();
+}
+
+auto sharded_subscriber::owner(const std::string& channel) -> ::result<node*, std::string>
+{
+    auto address = cluster.node_for(channel);
+    if (address.host.empty()) {
+        // we don't know who owns this slot - maybe the cluster changed
+        if (const auto e = Error(cluster.refresh()); e) {
+            return failed(e.value());
+        }
+        address = cluster.node_for(channel);
+        if (address.host.empty()) {
+            return failed("no node owns the slot of channel " + channel);
+        }
+    }
+    node* found = nullptr;
+    for (auto& n : nodes) {
+        if (n->address.port == address.port && n->address.host == address.host) {
+            found = n.get();
+            break;
+        }
+    }
+    if (!found) {
+        nodes.push_back(std::make_unique<node>());
+        found = nodes.back().get();
+        found->address = address;
+    }
+    if (!found->connection) {
+        if (const auto e = Error(cluster.connect(found->address, found->connection)); e) {
+            return failed("failed to connect to " + address.host + ":" + std::to_string(address.port) + ": " + e.value());
+        }
+    }
+    return ok(found);
+}
+
+auto sharded_subscriber::send(node& to, const char* command, const std::string& channel) -> result_t
+{
+    to.out.clear();
+    to.out.command(command, channel);
+    return internal::resp::send(to.connection, to.out.data());
+}
+
+auto sharded_subscriber::subscribe(const std::string& channel, handler_t handler) -> result_t
+{
+    if (channel.empty()) {
+        return failed("cannot subscribe to channel without a name"s);
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto& s = channels[channel];
+        const auto added = !s.handler;
+        s.handler = std::make_shared<handler_t>(std::move(handler));
+        if (!added) {
+            return ok(true);    // only replaced the handler
+        }
+        joining.push_back(channel);
+    }
+    wake.notify();
+    return ok(true);
+}
+
+auto sharded_subscriber::unsubscribe(const std::string& channel) -> result_t
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const auto s = channels.find(channel);
+        if (s == channels.end()) {
+            return ok(false);
+        }
+        if (s->second.at) {
+            leaving.emplace_back(s->second.at, channel);
+        }
+        channels.erase(s);
+    }
+    wake.notify();
+    return ok(true);
+}
+
+auto sharded_subscriber::apply() -> void
+{
+    // first the ones that we are leaving, in case we are subscribing to them again
+    for (const auto& [at, name] : leaving) {
+        if (at->connection) {
+            send(*at, internal::pubsub::unsubscribe_command(true), name);
+        }
+    }
+    leaving.clear();
+    for (const auto& name : joining) {
+        const auto s = channels.find(name);
+        if (s == channels.end() || s->second.at) {
+            continue;   // unsubscribed before we got to it, or we already have it
+        }
+        const auto o = owner(name);
+        if (o.is_error() || send(*o.unwrap(), internal::pubsub::subscribe_command(true), name).is_error()) {
+            moved = true;   // the next rebalance would try again
+            continue;
+        }
+        s->second.at = o.unwrap();
+    }
+    joining.clear();
+}
+
+auto sharded_subscriber::broken(node& at) -> void
+{
+    at.connection.close_it();
+    for (auto& [name, s] : channels) {
+        if (s.at == &at) {
+            s.at = nullptr;     // we would subscribe again on a new connection
+        }
+    }
+    moved = true;
+}
+
+auto sharded_subscriber::rebalance() -> void
+{
+    cluster.refresh();
+    moved = false;
+    for (auto& [name, s] : channels) {
+        const auto o = owner(name);
+        if (o.is_error()) {
+            s.at = nullptr;
+            moved = true;       // try again later
+            continue;
+        }
+        if (o.unwrap() == s.at) {
+            continue;
+        }
+        if (s.at && s.at->connection) {
+            send(*s.at, internal::pubsub::unsubscribe_command(true), name);
+        }
+        if (send(*o.unwrap(), internal::pubsub::subscribe_command(true), name).is_error()) {
+            s.at = nullptr;
+            moved = true;
+            continue;
+        }
+        s.at = o.unwrap();
+        ++resubscribes;
+    }
+}
+
+auto sharded_subscriber::process(node& from) -> std::size_t
+{
+    auto& in = buffers(from.connection).in;
+    std::size_t count = 0;
+    while (true) {
+        const auto r = in.next();
+        if (r.is_error()) {
+            std::lock_guard<std::mutex> guard(lock);
+            broken(from);
+            return count;
+        }
+        const auto& reply = r.unwrap();
+        if (!reply) {
+            return count;
+        }
+        if (reply->is_error()) {
+            // most likely MOVED for a channel that we subscribed to on the wrong node
+            std::lock_guard<std::mutex> guard(lock);
+            moved = true;
+            continue;
+        }
+        const auto event = internal::pubsub::classify(*reply, true);
+        if (event.kind == internal::pubsub::event::UNSUBSCRIBED) {
+            // if we still have this channel, then we didn't ask for it - the slot moved
+            std::lock_guard<std::mutex> guard(lock);
+            if (const auto s = channels.find(std::string(event.channel)); s != channels.end() && s->second.at == &from) {
+                s->second.at = nullptr;
+                moved = true;
+            }
+        } else if (event.kind == internal::pubsub::event::MESSAGE) {
+            std::shared_ptr<handler_t> handler;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (const auto s = channels.find(std::string(event.channel)); s != channels.end()) {
+                    handler = s->second.handler;
+                }
+            }
+            if (handler) {
+                ++messages;
+                ++count;
+                (*handler)(event.channel, event.payload);
+            } else {
+                ++dropped;
+            }
+        }
+    }
+}
+
+auto sharded_subscriber::poll(milliseconds_t timeout) -> ::result<std::size_t, std::string>
+{
+    const auto forever = timeout.count() < 0;
+    const auto deadline = clock_type::now() + (forever ? milliseconds_t{0} : timeout);
+    auto retry_at = clock_type::now();
+    std::vector<node*> active;
+    std::vector<pollfd> wait_for;
+    while (!stopped) {
+        active.clear();
+        bool retry = false;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            apply();
+            if (moved && clock_type::now() >= retry_at) {
+                rebalance();
+                retry_at = clock_type::now() + RETRY_AFTER;
+            }
+            retry = moved;
+            for (auto& n : nodes) {
+                if (n->connection) {
+                    active.push_back(n.get());
+                }
+            }
+        }
+        std::size_t count = 0;
+        for (auto n : active) {
+            count += process(*n);
+        }
+        if (count > 0) {
+            return ok(count);
+        }
+        // we may have closed some of them while processing
+        active.erase(std::remove_if(active.begin(), active.end(), [](const node* n) { return !n->connection; }), active.end());
+        auto wait = milliseconds_t{-1};
+        if (!forever) {
+            wait = std::chrono::duration_cast<milliseconds_t>(deadline - clock_type::now());
+            if (wait.count() <= 0) {
+                return ok(count);
+            }
+        }
+        if (retry && (wait.count() < 0 || wait > RETRY_AFTER)) {
+            wait = RETRY_AFTER;
+        }
+        wait_for.clear();
+        wait_for.push_back(pollfd{wake.handle(), POLLIN, 0});
+        for (auto n : active) {
+            wait_for.push_back(pollfd{cast(n->connection)->fd, POLLIN, 0});
+        }
+        int ready = 0;
+        do {
+            ready = ::poll(wait_for.data(), wait_for.size(), static_cast<int>(wait.count()));
+        } while (ready < 0 && errno == EINTR);
+        if (ready < 0) {
+            return failed("failed to wait for the cluster nodes: "s + std::strerror(errno));
+        }
+        if (wake.consume()) {
+            continue;   // either stop, or there are subscriptions to apply
+        }
+        for (std::size_t i = 1; i < wait_for.size(); ++i) {
+            if (wait_for[i].revents == 0) {
+                continue;
+            }
+            auto& n = *active[i - 1];
+            if (internal::resp::fill(n.connection, milliseconds_t{0}).is_error()) {
+                // the node is gone, we would find the new owners of its channels
+                std::lock_guard<std::mutex> guard(lock);
+                broken(n);
+                retry_at = clock_type::now();
+            }
+        }
+    }
+    return ok(std::size_t{0});
+}
+
+auto sharded_subscriber::run() -> result_t
+{
+    while (!stopped) {
+        if (const auto r = poll(milliseconds_t{-1}); r.is_error()) {
+            stopped = false;
+            return failed(r.error_value());
+        }
+    }
+    stopped = false;
+    return ok(true);
+}
+
+auto sharded_subscriber::stop() -> void
+{
+    stopped = true;
+    wake.notify();
+}
+
+auto sharded_subscriber::size() const -> std::size_t
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return channels.size();
+}
+
+auto sharded_subscriber::statistics() const -> stats
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::size_t connections = 0;
+    for (const auto& n : nodes) {
+        if (n->connection) {
+            ++connections;
+        }
+    }
+    return stats{messages.load(), dropped.load(), resubscribes, connections};
+}
+
+}   // end of namespace redis
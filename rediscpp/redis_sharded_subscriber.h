@@ -0,0 +1,137 @@
+#pragma once
+
+#include "redis_cluster.h"
+#include "rediscpp/internal/resp.h"
+#include "rediscpp/internal/wakeup.h"
+#include "result/results.h"
+#include <string>
+#include <string_view>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * with redis 7 sharded pub/sub, the messages of a channel are only going to the node that
+ * owns the slot of the channel name (and its replicas), and not to all the nodes in the cluster,
+ * so adding nodes to the cluster is adding pub/sub capacity. This means that we must subscribe
+ * on the node that owns the channel. The sharded subscriber keeps one connection for each node that
+ * owns any of the channels that we subscribed to, and dispatches the messages from all of them.
+ * When a slot is moved, the node tells us that we are no longer subscribed (or it is no longer reachable),
+ * and we subscribe again on the new owner.
+ * To publish to sharded channel use channel with channel::SHARDED over the cluster end point.
+ * Note that the cluster end point is used to find the owners of the channels, so while the subscriber
+ * is reading, don't use the cluster end point from other threads.
+ * Only the reading thread (poll/run) is talking to the nodes - subscribe and unsubscribe are
+ * queued, and the reading thread sends them the next time it wakes up.
+ **/
+
+namespace redis
+{
+    /* usage:
+        cluster_end_point cluster({{"127.0.0.1", 7000}});
+        sharded_subscriber subscriptions(cluster);
+        subscriptions.subscribe("orders", [](std::string_view channel, std::string_view message) {
+            std::cout<<"got "<<message<<" on "<<channel<<std::endl;
+        });
+        std::thread reader([&subscriptions]() { subscriptions.run(); });
+        // some where else
+        channel orders("orders", cluster.get(), channel::SHARDED);
+        orders.make_publisher().send("new order");  // SPUBLISH to the node that owns "orders"
+        // ..
+        subscriptions.stop();
+        reader.join();
+    */
+    struct sharded_subscriber
+    {
+        using result_t = ::result<bool, std::string>;
+        using milliseconds_t = end_point::milliseconds_t;
+        using handler_t = std::function<void(std::string_view channel, std::string_view message)>;
+
+        struct stats
+        {
+            std::uint64_t messages = 0;
+            std::uint64_t dropped = 0;          // messages for channels that we no longer have handler for
+            std::uint64_t resubscribes = 0;     // the times that we moved a channel to another node
+            std::size_t connections = 0;        // the number of nodes that we are connected to
+        };
+
+        explicit sharded_subscriber(cluster_end_point& cluster);
+
+        ~sharded_subscriber();
+
+        sharded_subscriber(const sharded_subscriber&) = delete;
+        sharded_subscriber& operator = (const sharded_subscriber&) = delete;
+
+        // if we already have handler for this channel, it is replaced. The subscription itself
+        // is sent by the reading thread, and if the owner of the channel cannot be reached
+        // it keeps trying, so this only fails for invalid input
+        auto subscribe(const std::string& channel, handler_t handler) -> result_t;
+
+        // return false if we were not subscribed to this channel
+        auto unsubscribe(const std::string& channel) -> result_t;
+
+        // wait up to the timeout for messages and pass them to the handlers. Return the number
+        // of messages that were processed. Only one thread should call this (or run)
+        auto poll(milliseconds_t timeout) -> ::result<std::size_t, std::string>;
+
+        // process messages until stop is called
+        auto run() -> result_t;
+
+        // can be called from any thread
+        auto stop() -> void;
+
+        auto size() const -> std::size_t;
+
+        auto statistics() const -> stats;
+
+    private:
+        struct node
+        {
+            cluster_end_point::node_t address;
+            end_point connection;
+            internal::resp::writer out;
+        };
+
+        struct subscription
+        {
+            std::shared_ptr<handler_t> handler;
+            node* at = nullptr;
+        };
+
+        // these are called with the lock held, and only from the reading thread
+        auto owner(const std::string& channel) -> ::result<node*, std::string>;
+
+        auto send(node& to, const char* command, const std::string& channel) -> result_t;
+
+        // close the connection to the node, the channels on it would be moved on the next rebalance
+        auto broken(node& at) -> void;
+
+        // find the current owners of the channels, and move the channels that are not on their owner
+        auto rebalance() -> void;
+
+        // send the subscriptions that were queued since the last time
+        auto apply() -> void;
+
+        // read what we have from the node and pass the messages to the handlers
+        auto process(node& from) -> std::size_t;
+
+        cluster_end_point& cluster;
+        mutable std::mutex lock;
+        std::vector<std::unique_ptr<node>> nodes;   // nodes are never removed, so we can keep pointers to them
+        std::unordered_map<std::string, subscription> channels;
+        bool moved = false;                         // some channel is not on its owner anymore
+        std::vector<std::string> joining;           // channels that we need to subscribe to
+        std::vector<std::pair<node*, std::string>> leaving;     // and to unsubscribe from
+        internal::wakeup wake;
+        std::atomic<bool> stopped{false};
+        std::atomic<std::uint64_t> messages{0};
+        std::atomic<std::uint64_t> dropped{0};
+        std::uint64_t resubscribes = 0;
+    };
+}   // end of namespace redis
+
@@ -0,0 +1,311 @@
+#include "redis_stream.h"
+#include "redis_pipeline.h"
+#include "rediscpp/internal/commands.h"
+#include <algorithm>
+
+namespace redis
+{
+
+using namespace std::string_literals;
+
+namespace
+{
+    const std::string MESSAGE_FIELD = "message";
+
+    auto text(const result::any& from) -> std::string
+    {
+        const auto s = from.as_string();
+        if (s.is_ok()) {
+            return result::to_string(s.unwrap());
+        }
+        const auto st = from.as_status();
+        return st.is_ok() ? std::string(st.unwrap().message()) : std::string{};
+    }
+
+    // [id, [field, value, ..]] - the fields are null for entries that were deleted
+    auto to_entry(const result::any& from) -> std::optional<stream_entry>
+    {
+        const auto a = from.as_array();
+        if (a.is_error() || a.unwrap().size() < 2) {
+            return {};
+        }
+        const auto& entry = a.unwrap();
+        stream_entry out{text(entry.view(0)), {}};
+        if (const auto fields = entry.view(1).as_array(); fields.is_ok()) {
+            const auto& f = fields.unwrap();
+            out.fields.reserve(f.size() / 2);
+            for (std::size_t i = 0; i + 1 < f.size(); i += 2) {
+                out.fields.emplace_back(text(f.view(i)), text(f.view(i + 1)));
+            }
+        }
+        return out;
+    }
+
+    auto to_entries(const result::any& from, std::vector<stream_entry>& into) -> void
+    {
+        const auto a = from.as_array();
+        if (a.is_error()) {
+            return;
+        }
+        const auto& entries = a.unwrap();
+        into.reserve(into.size() + entries.size());
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            if (auto e = to_entry(entries.view(i)); e) {
+                into.push_back(std::move(*e));
+            }
+        }
+    }
+
+    // XREAD(GROUP) reply is null on timeout, or a list of [stream, entries] with
+    // RESP2, or a map of stream to entries with RESP3 (that we get as flat list)
+    auto read_reply(const result::any& from) -> std::vector<stream_entry>
+    {
+        std::vector<stream_entry> out;
+        const auto a = from.as_array();
+        if (a.is_error()) {
+            return out;
+        }
+        const auto& streams = a.unwrap();
+        for (std::size_t i = 0; i < streams.size(); ++i) {
+            const auto s = streams.view(i);
+            if (const auto pair = s.as_array(); pair.is_ok()) {
+                if (pair.unwrap().size() >= 2) {
+                    to_entries(pair.unwrap().view(1), out);
+                }
+            } else if (i + 1 < streams.size()) {
+                to_entries(streams.view(++i), out);
+            }
+        }
+        return out;
+    }
+
+    auto encode_add(internal::resp::writer& out, const std::string& key, std::size_t max_length,
+                    std::size_t fields) -> internal::resp::writer&
+    {
+        out.begin(3 + (max_length > 0 ? 3 : 0) + fields * 2).arg("XADD").arg(key);
+        if (max_length > 0) {
+            out.arg("MAXLEN").arg("~").arg(max_length);
+        }
+        return out.arg("*");
+    }
+}   // end of local namespace
+
+auto stream_entry::message() const -> std::string_view
+{
+    const auto f = std::find_if(fields.begin(), fields.end(), [](const auto& field) {
+        return field.first == MESSAGE_FIELD;
+    });
+    return f == fields.end() ? std::string_view{} : std::string_view{f->second};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+stream_channel::stream_channel(std::string name, end_point ep) : key{std::move(name)}, connection{std::move(ep)}
+{
+    if (!connection) {
+        throw connection_error("trying to create stream with invalid redis endpoint object");
+    }
+}
+
+auto stream_channel::name() const -> const std::string&
+{
+    return key;
+}
+
+auto stream_channel::by() const -> end_point&
+{
+    return connection;
+}
+
+auto stream_channel::create_group(const std::string& group, const std::string& from) -> result_t
+{
+    const auto r = internal::process<void>::run(connection, "XGROUP", "CREATE", key, group, from, "MKSTREAM");
+    if (r.is_error() && r.error_value().find("BUSYGROUP") != std::string::npos) {
+        return ok(false);
+    }
+    return r;
+}
+
+auto stream_channel::length() const -> ::result<std::int64_t, std::string>
+{
+    return internal::process<result::integer>::run(connection, "XLEN", key).and_then([](auto&& i) -> ::result<std::int64_t, std::string> {
+        return ok(i.message());
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+stream_publisher::stream_publisher(const stream_channel& c) : stream_publisher(c, options{})
+{
+}
+
+stream_publisher::stream_publisher(const stream_channel& c, options opts) : stream{c}, config{opts}
+{
+}
+
+auto stream_publisher::send(std::string_view message) const -> id_t
+{
+    auto& out = buffers(stream.by()).out;
+    out.clear();
+    encode_add(out, stream.name(), config.max_length, 1).arg(MESSAGE_FIELD).arg(message);
+    return internal::run_encoded(stream.by()).and_then([](auto&& r) -> id_t {
+        return ok(text(r));
+    });
+}
+
+auto stream_publisher::send(const fields_t& fields) const -> id_t
+{
+    if (fields.empty()) {
+        return failed("stream entry must have at least one field"s);
+    }
+    auto& out = buffers(stream.by()).out;
+    out.clear();
+    encode_add(out, stream.name(), config.max_length, fields.size());
+    for (const auto& [f, v] : fields) {
+        out.arg(f).arg(v);
+    }
+    return internal::run_encoded(stream.by()).and_then([](auto&& r) -> id_t {
+        return ok(text(r));
+    });
+}
+
+auto stream_publisher::send_batch(const std::vector<std::string_view>& messages) const -> ::result<std::vector<std::string>, std::string>
+{
+    pipeline batch(stream.by());
+    std::vector<deferred<result::string>> replies;
+    replies.reserve(messages.size());
+    for (const auto m : messages) {
+        encode_add(batch.encoder(), stream.name(), config.max_length, 1).arg(MESSAGE_FIELD).arg(m);
+        replies.emplace_back(batch.track());
+    }
+    if (const auto e = Error(batch.exec()); e) {
+        return failed(e.value());
+    }
+    std::vector<std::string> ids;
+    ids.reserve(replies.size());
+    for (const auto& r : replies) {
+        const auto id = r.get();
+        if (id.is_error()) {
+            return failed(id.error_value());
+        }
+        ids.push_back(result::to_string(id.unwrap()));
+    }
+    return ok(std::move(ids));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+stream_consumer::stream_consumer(const stream_channel& c, std::string g, std::string consumer) :
+    stream_consumer(c, std::move(g), std::move(consumer), options{})
+{
+}
+
+stream_consumer::stream_consumer(const stream_channel& c, std::string g, std::string consumer, options opts) :
+    stream{c}, group{std::move(g)}, name{std::move(consumer)}, config{opts}, history{opts.recover ? "0" : ""}
+{
+}
+
+stream_consumer::~stream_consumer()
+{
+    if (!acks.empty() && stream.by()) {
+        flush();
+    }
+}
+
+auto stream_consumer::read() -> entries_t
+{
+    pipeline batch(stream.by());
+    deferred<result::integer> acked;
+    if (!acks.empty()) {
+        // XACK is sent before the read, so the server already knows about these when it answers it
+        auto& out = batch.encoder();
+        out.begin(3 + acks.size()).arg("XACK").arg(stream.name()).arg(group);
+        for (const auto& id : acks) {
+            out.arg(id);
+        }
+        acked = deferred<result::integer>{batch.track()};
+    }
+    // while recovering we only read what was already delivered to us, so there is no point to wait
+    const auto wait = history.empty() && config.block.count() != 0;
+    auto& out = batch.encoder();
+    out.begin(wait ? 10 : 8).arg("XREADGROUP").arg("GROUP").arg(group).arg(name).arg("COUNT").arg(config.count);
+    if (wait) {
+        out.arg("BLOCK").arg(config.block.count() < 0 ? 0 : config.block.count());
+    }
+    out.arg("STREAMS").arg(stream.name()).arg(history.empty() ? ">"s : history);
+    const auto reply = deferred<result::any>{batch.track()};
+
+    if (const auto e = Error(batch.exec()); e) {
+        return failed(e.value());      // the acknowledgements are kept, it is safe to send them again
+    }
+    if (acked.ready() && acked.get().is_ok()) {
+        acks.clear();
+    }
+    const auto r = reply.get();
+    if (r.is_error()) {
+        return failed(r.error_value());
+    }
+    auto entries = read_reply(r.unwrap());
+    if (!history.empty()) {
+        if (entries.empty()) {
+            history.clear();    // we are done with the old entries, from now on we are reading new ones
+            return read();
+        }
+        history = entries.back().id;
+    }
+    return ok(std::move(entries));
+}
+
+auto stream_consumer::ack(std::string id) -> void
+{
+    acks.push_back(std::move(id));
+    if (acks.size() >= config.ack_batch) {
+        flush();
+    }
+}
+
+auto stream_consumer::flush() -> ::result<std::int64_t, std::string>
+{
+    if (acks.empty()) {
+        return ok(std::int64_t{0});
+    }
+    auto& out = buffers(stream.by()).out;
+    out.clear();
+    out.begin(3 + acks.size()).arg("XACK").arg(stream.name()).arg(group);
+    for (const auto& id : acks) {
+        out.arg(id);
+    }
+    const auto r = internal::run_encoded(stream.by());
+    if (r.is_error()) {
+        return failed(r.error_value());
+    }
+    acks.clear();
+    return result::try_into<result::integer>(r.unwrap()).and_then([](auto&& i) -> ::result<std::int64_t, std::string> {
+        return ok(i.message());
+    });
+}
+
+auto stream_consumer::claim(milliseconds_t min_idle) -> entries_t
+{
+    // [next cursor, entries, deleted ids (since redis 7)]
+    const auto r = internal::process<result::array>::run(stream.by(), "XAUTOCLAIM", stream.name(), group, name,
+                                                         min_idle.count(), claim_from, "COUNT", config.count);
+    if (r.is_error()) {
+        return failed(r.error_value());
+    }
+    const auto& reply = r.unwrap();
+    if (reply.size() < 2) {
+        return failed("invalid reply for XAUTOCLAIM"s);
+    }
+    claim_from = text(reply.view(0));
+    std::vector<stream_entry> entries;
+    to_entries(reply.view(1), entries);
+    return ok(std::move(entries));
+}
+
+auto stream_consumer::pending_acks() const -> std::size_t
+{
+    return acks.size();
+}
+
+}   // end of namespace redis
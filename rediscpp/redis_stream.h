@@ -0,0 +1,151 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include "result/results.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * with pub/sub (see redis_channel.h) a message is lost if no subscriber is listening when
+ * it was published. With redis streams the messages are stored, and a consumer group is
+ * tracking which messages were delivered to each consumer in the group, and which of them were
+ * acknowledged. A consumer that was restarted would get the messages it did not acknowledge,
+ * and messages of a consumer that is gone can be claimed by another consumer in the group.
+ * Each message is read by only one consumer in the group, so to process more messages just add consumers.
+ * see https://redis.io/docs/data-types/streams/
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        stream_channel events("events", connection);
+        events.create_group("workers");
+        // in one process
+        stream_publisher sender(events, stream_publisher::options{100'000});    // keep about 100k entries
+        sender.send("a message");
+        // in other process (each with its own connection)
+        stream_consumer reader(events, "workers", "worker-1");
+        while (true) {
+            const auto entries = reader.read();  // wait up to options::block for new messages
+            if (entries.is_error()) {
+                ..
+            }
+            for (const auto& e : entries.unwrap()) {
+                process(e.message());
+                reader.ack(e.id);           // sent together with the next read
+            }
+        }
+    */
+    struct stream_entry
+    {
+        using field_t = std::pair<std::string, std::string>;
+
+        std::string id;
+        std::vector<field_t> fields;
+
+        // the value of the "message" field (this is what stream_publisher::send(message) is using),
+        // empty if there is no such field
+        auto message() const -> std::string_view;
+    };
+
+    struct stream_channel
+    {
+        using result_t = ::result<bool, std::string>;
+
+        stream_channel(std::string name, end_point ep);
+
+        auto name() const -> const std::string&;
+
+        auto by() const -> end_point&;
+
+        // create the consumer group (and the stream if it doesn't exists). The group would get the
+        // messages from the given id, by default only new messages. Return false if the group already exists
+        auto create_group(const std::string& group, const std::string& from = "$") -> result_t;
+
+        auto length() const -> ::result<std::int64_t, std::string>;
+
+    private:
+        std::string key;
+        mutable end_point connection;
+    };
+
+    struct stream_publisher
+    {
+        using id_t = ::result<std::string, std::string>;
+        using fields_t = std::vector<std::pair<std::string_view, std::string_view>>;
+
+        struct options
+        {
+            std::size_t max_length = 0;     // trim the stream to about this size (MAXLEN ~), 0 to never trim
+        };
+
+        explicit stream_publisher(const stream_channel& c);
+
+        stream_publisher(const stream_channel& c, options opts);
+
+        // add the message as the "message" field, return the id of the new entry
+        auto send(std::string_view message) const -> id_t;
+
+        auto send(const fields_t& fields) const -> id_t;
+
+        // all the messages are sent in one write, return the ids of the new entries
+        auto send_batch(const std::vector<std::string_view>& messages) const -> ::result<std::vector<std::string>, std::string>;
+
+    private:
+        stream_channel stream;
+        options config;
+    };
+
+    struct stream_consumer
+    {
+        using milliseconds_t = end_point::milliseconds_t;
+        using entries_t = ::result<std::vector<stream_entry>, std::string>;
+
+        struct options
+        {
+            std::size_t count = 100;                    // most entries to return from a single read
+            milliseconds_t block = milliseconds_t{1000};// how long to wait for new entries, 0 to not wait, negative to wait forever
+            std::size_t ack_batch = 256;                // send the acknowledgements once we have this many
+            bool recover = true;                        // first read the entries that we didn't acknowledge before
+        };
+
+        stream_consumer(const stream_channel& c, std::string group, std::string consumer);
+
+        stream_consumer(const stream_channel& c, std::string group, std::string consumer, options opts);
+
+        // send any acknowledgement that we still have
+        ~stream_consumer();
+
+        // read the next entries for this consumer. Acknowledgements that we have are sent in the
+        // same write. Return empty list if there are no new entries in options::block
+        auto read() -> entries_t;
+
+        // mark the entry as processed, this is only sent with the next read or flush, or once
+        // we have options::ack_batch of them
+        auto ack(std::string id) -> void;
+
+        // send the acknowledgements now, return the number of entries that were acknowledged
+        auto flush() -> ::result<std::int64_t, std::string>;
+
+        // take over entries of other consumers in the group, that were not acknowledged for
+        // at least min_idle. Each call continues from where the last one stopped
+        auto claim(milliseconds_t min_idle) -> entries_t;
+
+        auto pending_acks() const -> std::size_t;
+
+    private:
+        stream_channel stream;
+        std::string group;
+        std::string name;
+        options config;
+        std::vector<std::string> acks;
+        std::string claim_from = "0-0";
+        std::string history;            // while we are reading our own entries that were not acknowledged, where we are
+    };
+}   // end of namespace redis
+
@@ -0,0 +1,176 @@
+#include "redis_string_iterator.h"
+#include "redis_pipeline.h"
+#include "rediscpp/internal/commands.h"
+#include <unordered_map>
+#include <deque>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace redis
+{
+
+namespace details
+{
+    namespace
+    {
+        constexpr auto NO_BLOCK = std::numeric_limits<std::size_t>::max();
+    }   // end of local namespace
+
+    struct string_blocks::cache
+    {
+        struct block
+        {
+            deferred<result::string> reply;     // the data is pointing into it
+            std::string_view data;
+        };
+
+        std::unordered_map<std::size_t, block> loaded;
+        std::deque<std::size_t> order;          // the order in which we loaded them, to remove the oldest
+        std::size_t current = NO_BLOCK;         // the block that we used last, so we don't need to look for it
+        std::string_view data;
+        std::size_t last = NO_BLOCK;            // the last block that we read in the last load
+        std::size_t run = 1;                    // the number of blocks that we read in the last load
+    };
+
+    string_blocks::string_blocks(end_point ep, std::string key, options opts) :
+        connection{std::move(ep)}, name{std::move(key)}, config{opts}, blocks{std::make_unique<cache>()}
+    {
+        if (config.block == 0) {
+            throw std::invalid_argument("the block size must be positive");
+        }
+        const auto r = internal::process_validate<result::integer>::run(connection, "STRLEN", name);
+        length = static_cast<std::size_t>(r.message());
+    }
+
+    string_blocks::~string_blocks() = default;
+
+    auto string_blocks::size() const -> std::size_t
+    {
+        return length;
+    }
+
+    auto string_blocks::at(std::size_t pos) -> char
+    {
+        if (pos >= length) {
+            throw std::out_of_range("reading beyond the end of " + name);
+        }
+        const auto index = pos / config.block;
+        if (index != blocks->current) {
+            auto found = blocks->loaded.find(index);
+            if (found == blocks->loaded.end()) {
+                load(index);
+                found = blocks->loaded.find(index);
+            }
+            blocks->current = index;
+            blocks->data = found->second.data;
+        }
+        const auto offset = pos % config.block;
+        // the value may be shorter now if it was changed after we started
+        return offset < blocks->data.size() ? blocks->data[offset] : '\0';
+    }
+
+    auto string_blocks::load(std::size_t index) -> void
+    {
+        auto& c = *blocks;
+        // as long as we are reading sequentially, we are reading more blocks each time
+        c.run = (c.last != NO_BLOCK && index == c.last + 1) ? std::min(c.run * 2, std::max<std::size_t>(config.max_prefetch, 1)) : 1;
+        const auto total = (length + config.block - 1) / config.block;
+        const auto count = std::max<std::size_t>(std::min(c.run, total - index), 1);
+
+        pipeline batch(connection);
+        std::vector<std::pair<std::size_t, deferred<result::string>>> replies;
+        for (auto i = index; i < index + count; ++i) {
+            if (c.loaded.count(i) == 0) {
+                const auto from = i * config.block;
+                replies.emplace_back(i, internal::queue<result::string>(batch, "GETRANGE", name, from, from + config.block - 1));
+            }
+        }
+        if (const auto e = Error(batch.exec()); e) {
+            throw connection_error("failed to read " + name + ": " + e.value());
+        }
+        for (auto& [i, r] : replies) {
+            const auto data = r.value().message();
+            c.loaded.emplace(i, cache::block{std::move(r), data});
+            c.order.push_back(i);
+        }
+        c.last = index + count - 1;
+        while (c.loaded.size() > std::max(config.max_blocks, count) && !c.order.empty()) {
+            const auto oldest = c.order.front();
+            c.order.pop_front();
+            if (oldest == c.current) {
+                c.current = NO_BLOCK;
+            }
+            c.loaded.erase(oldest);
+        }
+    }
+}   // end of namespace details
+
+rstring_iterator::rstring_iterator(std::shared_ptr<details::string_blocks> from, std::size_t at) :
+    blocks{std::move(from)}, position{at}
+{
+}
+
+char rstring_iterator::operator [] (difference_type n) const
+{
+    return *(*this + n);
+}
+
+void rstring_iterator::increment()
+{
+    ++position;
+}
+
+void rstring_iterator::decrement()
+{
+    --position;
+}
+
+void rstring_iterator::advance(difference_type n)
+{
+    position = static_cast<std::size_t>(static_cast<difference_type>(position) + n);
+}
+
+rstring_iterator::difference_type rstring_iterator::distance_to(const rstring_iterator& other) const
+{
+    return static_cast<difference_type>(other.index(*this)) - static_cast<difference_type>(index(other));
+}
+
+bool rstring_iterator::equal(const rstring_iterator& other) const
+{
+    return index(other) == other.index(*this);
+}
+
+char rstring_iterator::dereference() const
+{
+    return blocks->at(position);
+}
+
+std::size_t rstring_iterator::index(const rstring_iterator& other) const
+{
+    if (blocks) {
+        return position;
+    }
+    return other.blocks ? other.blocks->size() : 0;
+}
+
+rstring_chars::rstring_chars(std::shared_ptr<details::string_blocks> from) : blocks{std::move(from)}
+{
+}
+
+rstring_iterator rstring_chars::begin() const
+{
+    return rstring_iterator(blocks, 0);
+}
+
+rstring_iterator rstring_chars::end() const
+{
+    return rstring_iterator(blocks, blocks->size());
+}
+
+std::size_t rstring_chars::size() const
+{
+    return blocks->size();
+}
+
+}   // end of namespace redis
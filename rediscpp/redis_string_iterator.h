@@ -0,0 +1,116 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include <boost/iterator/iterator_facade.hpp>
+#include <string>
+#include <memory>
+#include <iterator>
+#include <cstddef>
+
+/**
+ * rstring::operator [] is a round trip to the server for each char. The string iterator
+ * is reading the value in blocks (GETRANGE) and keeps the last few blocks, so walking over
+ * the value, either with a loop or with the STL algorithms, only needs a round trip per block.
+ * When the value is read sequentially, each time we need a new block we are asking for the
+ * next blocks as well in the same write, and we are asking for more of them (up to max_prefetch) as
+ * long as the access stays sequential.
+ * Note that the size of the value is taken when the iteration starts (begin), so if the value
+ * is changed while we are iterating, we may see a mix of the old and the new value.
+ * rstring::end() is a sentinel that is not bound to any value - it is the end of whatever iterator it
+ * is compared to, so it cannot be moved. To walk backward from the end, use rstring::chars, where
+ * both ends are reading the same blocks.
+ **/
+
+namespace redis
+{
+    namespace details
+    {
+        // the blocks of a string value that we already read - this is shared by all the iterators
+        // that were created from the same begin
+        struct string_blocks
+        {
+            struct options
+            {
+                std::size_t block = 4096;       // the size of each GETRANGE
+                std::size_t max_prefetch = 16;  // most blocks that we are reading in one write
+                std::size_t max_blocks = 64;    // most blocks that we keep in memory
+            };
+
+            string_blocks(end_point ep, std::string key, options opts);
+
+            // throws connection_error if we failed to read it from the server
+            auto at(std::size_t pos) -> char;
+
+            auto size() const -> std::size_t;
+
+            ~string_blocks();
+
+        private:
+            struct cache;
+
+            auto load(std::size_t index) -> void;
+
+            end_point connection;
+            std::string name;
+            options config;
+            std::size_t length = 0;
+            std::unique_ptr<cache> blocks;
+        };
+    }   // end of namespace details
+
+    struct rstring_iterator : public boost::iterator_facade<rstring_iterator, char,
+                                                            boost::random_access_traversal_tag,
+                                                            char
+                              >
+    {
+        // the chars are returned by value since the block that they are in may be dropped,
+        // but we can still jump to any position
+        using iterator_category = std::random_access_iterator_tag;
+        using iterator_concept = std::random_access_iterator_tag;
+
+        // the end sentinel
+        rstring_iterator() = default;
+
+        rstring_iterator(std::shared_ptr<details::string_blocks> from, std::size_t at);
+
+        // the facade would return a proxy here, and not the char
+        char operator [] (difference_type n) const;
+
+    private:
+        friend class boost::iterator_core_access;
+
+        void increment();
+
+        void decrement();
+
+        void advance(difference_type n);
+
+        difference_type distance_to(const rstring_iterator& other) const;
+
+        bool equal(const rstring_iterator& other) const;
+
+        char dereference() const;
+
+        // the sentinel is at the end of the value of the iterator that it is compared to
+        std::size_t index(const rstring_iterator& other) const;
+
+        std::shared_ptr<details::string_blocks> blocks;
+        std::size_t position = 0;
+    };
+
+    // the chars of the value, where all the iterators are sharing the same blocks
+    struct rstring_chars
+    {
+        explicit rstring_chars(std::shared_ptr<details::string_blocks> from);
+
+        rstring_iterator begin() const;
+
+        rstring_iterator end() const;
+
+        std::size_t size() const;
+
+    private:
+        std::shared_ptr<details::string_blocks> blocks;
+    };
+}   // end of namespace redis
+
@@ -0,0 +1,40 @@
+#include "redis_string_patch.h"
+#include <algorithm>
+
+namespace redis
+{
+
+auto diff(std::string_view old, std::string_view now, std::size_t merge) -> std::vector<patch_range>
+{
+    std::vector<patch_range> ranges;
+    const auto add = [&ranges, merge](std::size_t from, std::size_t to) {
+        if (!ranges.empty() && from - (ranges.back().offset + ranges.back().length) <= merge) {
+            ranges.back().length = to - ranges.back().offset;
+        } else {
+            ranges.push_back(patch_range{from, to - from});
+        }
+    };
+    const auto common = std::min(old.size(), now.size());
+    std::size_t i = 0;
+    while (i < common) {
+        // skip what did not change, then take what changed
+        const auto start = std::mismatch(old.begin() + i, old.begin() + common, now.begin() + i).first - old.begin();
+        i = static_cast<std::size_t>(start);
+        if (i == common) {
+            break;
+        }
+        auto end = i;
+        while (end < common && old[end] != now[end]) {
+            ++end;
+        }
+        add(i, end);
+        i = end;
+    }
+    if (now.size() > common) {
+        add(common, now.size());
+    }
+    return ranges;
+}
+
+}   // end of namespace redis
+
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+/**
+ * When a large value is changed only slightly (session state, serialized documents), setting it
+ * again is sending the whole value over the wire. Since we know what the value was before, we can
+ * find the ranges that changed, and only send them with SETRANGE (all of them in one write).
+ * When the changes are all over the value, it is cheaper to just set it, so when the ranges that
+ * we would send are more than some ratio of the value, we fall back to SET.
+ * Note that this is only correct if the value at the server is the old value - this is not
+ * checked, so if someone else may change the value, use SET.
+ **/
+
+namespace redis
+{
+    struct patch_options
+    {
+        std::size_t merge = 32;         // changed ranges that are closer than this are sent as one range
+        double max_ratio = 0.5;         // when more than this part of the value changed, send all of it
+    };
+
+    struct patch_stats
+    {
+        std::size_t sent = 0;           // the number of bytes that we sent
+        std::size_t saved = 0;          // the number of bytes that we did not need to send
+        std::size_t ranges = 0;         // the number of SETRANGE that we sent (0 when we sent SET)
+        bool full = false;              // the whole value was sent with SET
+    };
+
+    // a range of the new value that we need to send
+    struct patch_range
+    {
+        std::size_t offset = 0;
+        std::size_t length = 0;
+    };
+
+    // find the ranges in now that are different from old, including the part of now that is
+    // beyond the end of old. Ranges that are at most merge bytes apart are merged
+    auto diff(std::string_view old, std::string_view now, std::size_t merge) -> std::vector<patch_range>;
+}   // end of namespace redis
+
@@ -0,0 +1,274 @@
+#include "redis_string_stream.h"
+#include "rediscpp/internal/commands.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace redis
+{
+
+using namespace std::string_literals;
+
+rstring_readbuf::rstring_readbuf(const rstring& from) : rstring_readbuf(from, options{})
+{
+}
+
+rstring_readbuf::rstring_readbuf(const rstring& from, options opts) : source{from}, config{opts}
+{
+    if (config.chunk == 0 || config.prefetch == 0) {
+        throw std::invalid_argument("the chunk size and the prefetch must be positive");
+    }
+}
+
+auto rstring_readbuf::fetch() -> bool
+{
+    if (end) {
+        return false;
+    }
+    pipeline batch(source.by());
+    for (std::size_t i = 0; i < config.prefetch; ++i) {
+        windows.push_back(internal::queue<result::string>(batch, "GETRANGE", source.name(), next, next + config.chunk - 1));
+        next += config.chunk;
+    }
+    if (const auto e = Error(batch.exec()); e) {
+        throw connection_error("failed to read " + source.name() + ": " + e.value());
+    }
+    return true;
+}
+
+auto rstring_readbuf::underflow() -> int_type
+{
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    if (eback() != nullptr) {
+        // we are done with the current window (it is the first one)
+        offset += static_cast<std::size_t>(egptr() - eback());
+        windows.pop_front();
+        setg(nullptr, nullptr, nullptr);
+    }
+    if (windows.empty() && !fetch()) {
+        return traits_type::eof();
+    }
+    // the data is pointing into the reply, so we must keep it until we are done with this window
+    auto current = std::move(windows.front());
+    windows.pop_front();
+    const auto data = current.value().message();
+    if (data.size() < config.chunk) {
+        // this is the end of the value, the windows after it are empty
+        end = true;
+        windows.clear();
+    }
+    if (data.empty()) {
+        return traits_type::eof();
+    }
+    windows.push_front(std::move(current));
+    auto begin = const_cast<char*>(data.data());    // we never write into it
+    setg(begin, begin, begin + data.size());
+    return traits_type::to_int_type(*gptr());
+}
+
+auto rstring_readbuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) -> pos_type
+{
+    auto target = off;
+    if (dir == std::ios_base::cur) {
+        target += static_cast<off_type>(offset) + (gptr() - eback());
+    } else if (dir == std::ios_base::end) {
+        target += static_cast<off_type>(source.size());
+    }
+    return seekpos(pos_type(target), which);
+}
+
+auto rstring_readbuf::seekpos(pos_type pos, std::ios_base::openmode which) -> pos_type
+{
+    const auto at = static_cast<off_type>(pos);
+    if (!(which & std::ios_base::in) || at < 0) {
+        return pos_type(off_type(-1));
+    }
+    const auto target = static_cast<std::size_t>(at);
+    if (target >= offset && target < offset + static_cast<std::size_t>(egptr() - eback())) {
+        // still in the window that we have
+        setg(eback(), eback() + (target - offset), egptr());
+        return pos;
+    }
+    if (eback() != nullptr) {
+        windows.pop_front();    // this is the current window
+    }
+    setg(nullptr, nullptr, nullptr);
+    windows.clear();
+    offset = next = target;
+    end = false;
+    return pos;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+rstring_writebuf::rstring_writebuf(const rstring& to) : rstring_writebuf(to, options{})
+{
+}
+
+rstring_writebuf::rstring_writebuf(const rstring& to, options opts) :
+    target{to}, config{opts}, buffer(opts.chunk), batch{to.by()}
+{
+    if (config.chunk == 0 || config.depth == 0) {
+        throw std::invalid_argument("the chunk size and the depth must be positive");
+    }
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+rstring_writebuf::~rstring_writebuf()
+{
+    if (!abandoned) {
+        send(true);
+    }
+}
+
+auto rstring_writebuf::written() const -> std::size_t
+{
+    return queued;
+}
+
+auto rstring_writebuf::abandon() -> void
+{
+    abandoned = true;
+    setp(buffer.data(), buffer.data() + buffer.size());
+    batch.discard();
+    replies.clear();
+}
+
+auto rstring_writebuf::send(bool flush) -> bool
+{
+    if (abandoned) {
+        return false;
+    }
+    const auto size = static_cast<std::size_t>(pptr() - pbase());
+    const auto replace = !config.append && !config.at && !replaced;
+    // when we are replacing the value, and there is nothing to write, we still need to clear it
+    if (size > 0 || (flush && replace)) {
+        const auto data = std::string_view(pbase(), size);
+        if (config.at) {
+            replies.push_back(internal::queue<void>(batch, "SETRANGE", target.name(), *config.at + queued, data));
+        } else if (replace) {
+            replies.push_back(internal::queue<void>(batch, "SET", target.name(), data));
+            replaced = true;
+        } else {
+            replies.push_back(internal::queue<void>(batch, "APPEND", target.name(), data));
+        }
+        queued += size;
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+    if (batch.size() < config.depth && !(flush && !batch.empty())) {
+        return true;
+    }
+    const auto sent = batch.exec();
+    const auto good = sent.is_ok() && std::all_of(replies.begin(), replies.end(), [](const auto& r) {
+        return r.get().is_ok();
+    });
+    replies.clear();
+    return good;
+}
+
+auto rstring_writebuf::overflow(int_type c) -> int_type
+{
+    if (!send(false)) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+auto rstring_writebuf::sync() -> int
+{
+    return send(true) ? 0 : -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+rstring_istream::rstring_istream(const rstring& from, rstring_readbuf::options opts) :
+    std::istream{nullptr}, buffer{from, opts}
+{
+    rdbuf(&buffer);
+}
+
+rstring_ostream::rstring_ostream(const rstring& to, rstring_writebuf::options opts) :
+    std::ostream{nullptr}, buffer{to, opts}
+{
+    rdbuf(&buffer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+auto copy_to(const rstring& from, int fd, rstring_readbuf::options opts) -> ::result<std::size_t, std::string>
+{
+    try {
+        rstring_readbuf in(from, opts);
+        std::vector<char> chunk(opts.chunk);
+        std::size_t total = 0;
+        while (true) {
+            const auto n = in.sgetn(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            if (n <= 0) {
+                return ok(total);
+            }
+            auto at = chunk.data();
+            auto left = static_cast<std::size_t>(n);
+            while (left > 0) {
+                const auto w = ::write(fd, at, left);
+                if (w < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return failed("failed to write: "s + std::strerror(errno));
+                }
+                at += w;
+                left -= static_cast<std::size_t>(w);
+            }
+            total += static_cast<std::size_t>(n);
+        }
+    } catch (const connection_error& e) {
+        return failed(std::string(e.what()));
+    }
+}
+
+auto copy_from(int fd, const rstring& to, rstring_writebuf::options opts) -> ::result<std::size_t, std::string>
+{
+    std::optional<rstring_writebuf> out;     // outside of the try, so we can abandon it on failure
+    try {
+        out.emplace(to, opts);
+        std::vector<char> chunk(opts.chunk);
+        std::size_t total = 0;
+        while (true) {
+            const auto n = ::read(fd, chunk.data(), chunk.size());
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                out->abandon();
+                return failed("failed to read: "s + std::strerror(errno));
+            }
+            if (n == 0) {
+                break;
+            }
+            if (out->sputn(chunk.data(), n) != n) {
+                out->abandon();
+                return failed("failed to write to " + to.name());
+            }
+            total += static_cast<std::size_t>(n);
+        }
+        if (out->pubsync() != 0) {
+            return failed("failed to write to " + to.name());
+        }
+        return ok(total);
+    } catch (const connection_error& e) {
+        if (out) {
+            out->abandon();
+        }
+        return failed(std::string(e.what()));
+    }
+}
+
+}   // end of namespace redis
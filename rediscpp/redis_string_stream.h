@@ -0,0 +1,139 @@
+#pragma once
+
+#include "redis_messages.h"
+#include "redis_pipeline.h"
+#include "result/results.h"
+#include <streambuf>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <optional>
+#include <cstdint>
+
+/**
+ * rstring::str is reading the whole value into memory, and operator = is sending it all in
+ * one command. For large values (think of cached files of hundreds of MB) we would rather
+ * stream them - the reader is reading the value in windows of fixed size (GETRANGE), and is
+ * asking for the next few windows in one write, so we are not waiting for a round trip per window.
+ * The writer is sending the value in chunks, with APPEND, or with SETRANGE when writing at some
+ * offset of the value, again a few chunks in each write. In both cases we only hold a few chunks in memory.
+ * Note that the value is not read or written atomically - if someone else is changing the value
+ * while we are streaming it we may see part of the change.
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        rstring artifact(connection, "build:1234");
+        {
+            rstring_ostream out(artifact);
+            std::ifstream file("artifact.tar", std::ios::binary);
+            out<<file.rdbuf();
+        }   // the last chunk is sent here (or call flush)
+        rstring_istream in(artifact);
+        std::ofstream copy("copy.tar", std::ios::binary);
+        copy<<in.rdbuf();
+        // or directly to/from file descriptor
+        copy_to(artifact, fd);
+    */
+    struct rstring_readbuf : std::streambuf
+    {
+        struct options
+        {
+            std::size_t chunk = 1024 * 1024;    // the size of each GETRANGE
+            std::size_t prefetch = 4;           // the number of windows we are asking in each write
+        };
+
+        explicit rstring_readbuf(const rstring& from);
+
+        rstring_readbuf(const rstring& from, options opts);
+
+    protected:
+        auto underflow() -> int_type override;
+
+        auto seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) -> pos_type override;
+
+        auto seekpos(pos_type pos, std::ios_base::openmode which) -> pos_type override;
+
+    private:
+        // read the next windows, return false if there is nothing more to read
+        auto fetch() -> bool;
+
+        rstring source;
+        options config;
+        std::deque<deferred<result::string>> windows;   // the windows that we already read, the data is pointing into them
+        std::size_t offset = 0;                         // where the current window starts
+        std::size_t next = 0;                           // where the next window that we are asking for starts
+        bool end = false;                               // we already got the last window
+    };
+
+    struct rstring_writebuf : std::streambuf
+    {
+        struct options
+        {
+            std::size_t chunk = 1024 * 1024;    // the size of each APPEND or SETRANGE
+            std::size_t depth = 4;              // the number of chunks that we are sending in each write
+            bool append = false;                // add to the end of the current value, otherwise the value is replaced
+            std::optional<std::size_t> at;      // write at this offset (SETRANGE), the rest of the value is kept
+        };
+
+        explicit rstring_writebuf(const rstring& to);
+
+        rstring_writebuf(const rstring& to, options opts);
+
+        // send whatever we still have
+        ~rstring_writebuf() override;
+
+        // the number of bytes that were sent to the server so far
+        auto written() const -> std::size_t;
+
+        // drop what was not sent yet, and don't send anything more - what was already
+        // sent is kept, so the value may be partial
+        auto abandon() -> void;
+
+    protected:
+        auto overflow(int_type c) -> int_type override;
+
+        auto sync() -> int override;
+
+    private:
+        // queue what we have in the buffer, and if flush (or we have enough), send it
+        auto send(bool flush) -> bool;
+
+        rstring target;
+        options config;
+        std::vector<char> buffer;
+        pipeline batch;
+        std::vector<deferred<void>> replies;
+        std::size_t queued = 0;     // bytes that are in the pipeline or were sent
+        bool replaced = false;      // the value was replaced by the first chunk
+        bool abandoned = false;
+    };
+
+    struct rstring_istream : std::istream
+    {
+        explicit rstring_istream(const rstring& from, rstring_readbuf::options opts = {});
+
+    private:
+        rstring_readbuf buffer;
+    };
+
+    struct rstring_ostream : std::ostream
+    {
+        explicit rstring_ostream(const rstring& to, rstring_writebuf::options opts = {});
+
+    private:
+        rstring_writebuf buffer;
+    };
+
+    // write the value into the file descriptor, return the number of bytes that were written
+    auto copy_to(const rstring& from, int fd, rstring_readbuf::options opts = {}) -> ::result<std::size_t, std::string>;
+
+    // read from the file descriptor until its end, into the value. Return the number of bytes that were read.
+    // On failure the rest is not sent, but what was sent before it is kept, so the value may be partial
+    auto copy_from(int fd, const rstring& to, rstring_writebuf::options opts = {}) -> ::result<std::size_t, std::string>;
+}   // end of namespace redis
+
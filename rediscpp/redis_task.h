@@ -0,0 +1,198 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+/**
+ * minimal coroutine type to be used with the asynchronous redis operations (see redis_async.h).
+ * A task is lazy - it would only start running once it is awaited, or when it was given to spawn.
+ * Once a task is awaited, the awaiting coroutine would continue when the task finish, and
+ * would get its return value (or the exception that it threw).
+ **/
+
+namespace redis
+{
+    template<typename T>
+    struct task;
+
+    namespace details
+    {
+        struct task_promise_base
+        {
+            struct final_awaiter
+            {
+                auto await_ready() const noexcept -> bool {
+                    return false;
+                }
+
+                template<typename Promise>
+                auto await_suspend(std::coroutine_handle<Promise> h) noexcept -> std::coroutine_handle<> {
+                    if (auto c = h.promise().continuation; c) {
+                        return c;
+                    }
+                    return std::noop_coroutine();
+                }
+
+                auto await_resume() const noexcept -> void {
+                }
+            };
+
+            auto initial_suspend() const noexcept -> std::suspend_always {
+                return {};
+            }
+
+            auto final_suspend() const noexcept -> final_awaiter {
+                return {};
+            }
+
+            auto unhandled_exception() noexcept -> void {
+                error = std::current_exception();
+            }
+
+            auto rethrow() const -> void {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+        };
+
+        template<typename T>
+        struct task_promise : task_promise_base
+        {
+            auto get_return_object() -> task<T>;
+
+            template<typename U>
+            auto return_value(U&& v) -> void {
+                value.emplace(std::forward<U>(v));
+            }
+
+            auto result() -> T {
+                rethrow();
+                return std::move(*value);
+            }
+
+            std::optional<T> value;
+        };
+
+        template<>
+        struct task_promise<void> : task_promise_base
+        {
+            auto get_return_object() -> task<void>;
+
+            auto return_void() const noexcept -> void {
+            }
+
+            auto result() const -> void {
+                rethrow();
+            }
+        };
+
+        // this is used to start a task without waiting for it, it would release itself on exit
+        struct detached_task
+        {
+            struct promise_type
+            {
+                auto get_return_object() const noexcept -> detached_task {
+                    return {};
+                }
+
+                auto initial_suspend() const noexcept -> std::suspend_never {
+                    return {};
+                }
+
+                auto final_suspend() const noexcept -> std::suspend_never {
+                    return {};
+                }
+
+                auto return_void() const noexcept -> void {
+                }
+
+                auto unhandled_exception() const noexcept -> void {
+                    std::terminate();   // the task given to spawn must not throw
+                }
+            };
+        };
+    }   // end of namespace details
+
+    template<typename T = void>
+    struct task
+    {
+        using promise_type = details::task_promise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        task() = default;
+
+        explicit task(handle_type h) : handle{h} {
+        }
+
+        task(task&& other) noexcept : handle{std::exchange(other.handle, {})} {
+        }
+
+        auto operator = (task&& other) noexcept -> task& {
+            if (this != &other) {
+                reset();
+                handle = std::exchange(other.handle, {});
+            }
+            return *this;
+        }
+
+        task(const task&) = delete;
+        auto operator = (const task&) -> task& = delete;
+
+        ~task() {
+            reset();
+        }
+
+        auto await_ready() const noexcept -> bool {
+            return !handle || handle.done();
+        }
+
+        auto await_suspend(std::coroutine_handle<> waiter) noexcept -> std::coroutine_handle<> {
+            handle.promise().continuation = waiter;
+            return handle;
+        }
+
+        auto await_resume() -> T {
+            return handle.promise().result();
+        }
+
+    private:
+        auto reset() -> void {
+            if (handle) {
+                handle.destroy();
+                handle = {};
+            }
+        }
+
+        handle_type handle;
+    };
+
+    namespace details
+    {
+        template<typename T>
+        auto task_promise<T>::get_return_object() -> task<T> {
+            return task<T>{std::coroutine_handle<task_promise<T>>::from_promise(*this)};
+        }
+
+        inline auto task_promise<void>::get_return_object() -> task<void> {
+            return task<void>{std::coroutine_handle<task_promise<void>>::from_promise(*this)};
+        }
+
+        inline auto run_detached(task<void> t) -> detached_task {
+            co_await t;
+        }
+    }   // end of namespace details
+
+    // start running the task without waiting for it to finish, the task would run until its
+    // first suspension point on the calling thread, and then continue from the thread that
+    // resumes it (for redis operations, this is the thread running the io_context)
+    inline auto spawn(task<void> t) -> void {
+        details::run_detached(std::move(t));
+    }
+}   // end of namespace redis
+
@@ -0,0 +1,35 @@
+#include "redis_typed_map.h"
+#include "rediscpp/internal/commands.h"
+#include <boost/algorithm/string.hpp>
+
+namespace redis
+{
+
+namespace details
+{
+    auto set(end_point& ep, std::string_view key, std::string_view value) -> bool
+    {
+        const auto r = internal::process_validate<result::status>::run(ep, "SET", key, value);
+        return boost::algorithm::iequals(r.message(), "ok");
+    }
+
+    auto get(end_point& ep, std::string_view key) -> std::optional<result::string>
+    {
+        const auto r = internal::process_validate<result::any>::run(ep, "GET", key);
+        if (r.is_null()) {
+            return {};
+        }
+        const auto s = r.as_string();
+        if (s.is_error()) {
+            throw connection_error(s.error_value());
+        }
+        return s.unwrap();
+    }
+
+    auto del(end_point& ep, std::string_view key) -> bool
+    {
+        return internal::process_validate<result::integer>::run(ep, "DEL", key).message() > 0;
+    }
+}   // end of namespace details
+
+}   // end of namespace redis
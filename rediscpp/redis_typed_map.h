@@ -0,0 +1,189 @@
+#pragma once
+
+#include "redis_endpoint.h"
+#include "redis_reply.h"
+#include "redis_pipeline.h"
+#include <string>
+#include <string_view>
+#include <optional>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * rmap only stores strings, so everything else must be converted to text before we insert it,
+ * and parsed back after we read it. basic_rmap is doing the same as rmap, but for any key and
+ * value type, with codec that is chosen at compile time. A codec is a type with:
+ *  - buffer_type - a place for the encoded value, so encoding is not allocating
+ *  - static auto encode(const T& value, buffer_type& buffer) -> std::string_view
+ *  - static auto decode(std::string_view from) -> std::optional<T>
+ * The encoded value is written directly into the command buffer, and the value is decoded
+ * directly from the reply, so there are no intermediate strings.
+ * The codecs that we have:
+ *  - string_codec - for strings (this is what rmap is doing)
+ *  - decimal_codec - numbers as text (to_chars/from_chars), so they are still numbers for redis (INCRBY ..)
+ *  - binary_codec - the bytes of the value (fixed width), for numbers and trivially copyable structs.
+ *    Note that this is only readable by machines with the same layout (endianness, padding)
+ **/
+
+namespace redis
+{
+    /* usage:
+        end_point connection(..);
+        basic_rmap<std::string, double> prices(connection);     // the values are stored as text
+        prices.insert("apple", 1.25);
+        std::optional<double> p = prices.find("apple");
+        struct point { int x; int y; };
+        basic_rmap<std::uint64_t, point> points(connection);    // the keys are stored as text, and the values as bytes
+        points.insert(7, point{1, 2});
+        basic_rmap<std::string, std::int64_t, binary_codec<std::int64_t>> raw(connection);
+    */
+    template<typename T>
+    struct string_codec
+    {
+        struct buffer_type {};
+
+        static auto encode(const T& value, buffer_type&) -> std::string_view {
+            return std::string_view(value);
+        }
+
+        static auto decode(std::string_view from) -> std::optional<T> {
+            return T(from);
+        }
+    };
+
+    template<typename T>
+    struct decimal_codec
+    {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "decimal codec is only for numbers");
+
+        using buffer_type = std::array<char, 32>;   // enough for any number
+
+        static auto encode(const T& value, buffer_type& buffer) -> std::string_view {
+            const auto r = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+            return std::string_view(buffer.data(), static_cast<std::size_t>(r.ptr - buffer.data()));
+        }
+
+        static auto decode(std::string_view from) -> std::optional<T> {
+            T value{};
+            const auto r = std::from_chars(from.data(), from.data() + from.size(), value);
+            if (r.ec != std::errc{} || r.ptr != from.data() + from.size()) {
+                return {};
+            }
+            return value;
+        }
+    };
+
+    template<typename T>
+    struct binary_codec
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "binary codec is only for trivially copyable types");
+
+        struct buffer_type {};
+
+        static auto encode(const T& value, buffer_type&) -> std::string_view {
+            return std::string_view(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        static auto decode(std::string_view from) -> std::optional<T> {
+            if (from.size() != sizeof(T)) {
+                return {};
+            }
+            T value;
+            std::memcpy(&value, from.data(), sizeof(T));
+            return value;
+        }
+    };
+
+    namespace details
+    {
+        template<typename T, typename = void>
+        struct default_codec
+        {
+            using type = binary_codec<T>;
+        };
+
+        template<typename T>
+        struct default_codec<T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>>
+        {
+            using type = decimal_codec<T>;
+        };
+
+        template<typename T>
+        struct default_codec<T, std::enable_if_t<std::is_constructible_v<std::string_view, const T&> && !std::is_pointer_v<T>>>
+        {
+            using type = string_codec<T>;
+        };
+
+        // these are doing the actual work for all the basic_rmap types, the keys
+        // and values are already encoded. They throw connection_error on failure
+        auto set(end_point& ep, std::string_view key, std::string_view value) -> bool;
+
+        auto get(end_point& ep, std::string_view key) -> std::optional<result::string>;
+
+        auto del(end_point& ep, std::string_view key) -> bool;
+    }   // end of namespace details
+
+    // strings are stored as is, numbers as text and anything else as its bytes
+    template<typename T>
+    using default_codec = typename details::default_codec<T>::type;
+
+    template<typename Key, typename Value, typename Codec = default_codec<Value>, typename KeyCodec = default_codec<Key>>
+    struct basic_rmap
+    {
+        using key_type = Key;
+        using mapped_type = Value;
+        using codec_type = Codec;
+        using key_codec_type = KeyCodec;
+
+        explicit basic_rmap(end_point ep) : connection{std::move(ep)} {
+        }
+
+        // return false if failed
+        auto insert(const key_type& key, const mapped_type& value) const -> bool {
+            typename KeyCodec::buffer_type k;
+            typename Codec::buffer_type v;
+            return details::set(connection, KeyCodec::encode(key, k), Codec::encode(value, v));
+        }
+
+        // queue the insert to the pipeline - the result is available after exec
+        auto insert(pipeline& batch, const key_type& key, const mapped_type& value) const -> deferred<result::status> {
+            typename KeyCodec::buffer_type k;
+            typename Codec::buffer_type v;
+            batch.encoder().begin(3).arg("SET").arg(KeyCodec::encode(key, k)).arg(Codec::encode(value, v));
+            return deferred<result::status>{batch.track()};
+        }
+
+        // empty if we don't have this key. throws connection_error if the value cannot be decoded
+        auto find(const key_type& key) const -> std::optional<mapped_type> {
+            typename KeyCodec::buffer_type k;
+            const auto found = details::get(connection, KeyCodec::encode(key, k));
+            return found ? decode(*found) : std::optional<mapped_type>{};
+        }
+
+        // queue the lookup to the pipeline - after exec use decode to read the value
+        auto find(pipeline& batch, const key_type& key) const -> deferred<result::string> {
+            typename KeyCodec::buffer_type k;
+            batch.encoder().begin(2).arg("GET").arg(KeyCodec::encode(key, k));
+            return deferred<result::string>{batch.track()};
+        }
+
+        auto erase(const key_type& key) const -> bool {
+            typename KeyCodec::buffer_type k;
+            return details::del(connection, KeyCodec::encode(key, k));
+        }
+
+        static auto decode(const result::string& from) -> mapped_type {
+            auto value = Codec::decode(from.message());
+            if (!value) {
+                throw connection_error("the stored value cannot be decoded");
+            }
+            return std::move(*value);
+        }
+
+    private:
+        mutable end_point connection;
+    };
+}   // end of namespace redis
+